@@ -0,0 +1,597 @@
+#include <stdio.h>     // the standard c library
+#include "bsr.h"       // reference the header file with the BSR declarations
+#include <stdlib.h>    // provides memory allocation functions
+#include <string.h>    // provides memcpy() and memset()
+
+#define BSR_MAX_BLOCK_DIM 8      // largest supported number of rows or columns per block
+#define BSR_SAMPLED_BLOCK_ROWS 2000 // the block size heuristic looks at about this many block rows per candidate
+
+// Allocates a column marker with every entry set to -1, see the addition function for how the markers are used
+static int *allocateMarker(int length)
+{
+    int *marker = (int *)allocateOrExit((size_t)length * sizeof(int), "the block column marker");
+    memset(marker, -1, (size_t)length * sizeof(int));
+    return marker;
+}
+
+BSRMatrix csrToBSR(const CSRMatrix *A, int r, int c)
+{
+    if (r < 1 || c < 1 || r > BSR_MAX_BLOCK_DIM || c > BSR_MAX_BLOCK_DIM)
+    {
+        fprintf(stderr, "Error: Block sizes must be between 1 and %d.\n", BSR_MAX_BLOCK_DIM);
+        exit(EXIT_FAILURE);
+    }
+
+    BSRMatrix B;
+    B.r = r;
+    B.c = c;
+    B.num_rows = A->num_rows;
+    B.num_cols = A->num_cols;
+    B.num_non_zeros = A->num_non_zeros;
+    B.num_block_rows = (A->num_rows + r - 1) / r; // round up so the rows of a partial last block are included
+    B.num_block_cols = (A->num_cols + c - 1) / c;
+    B.block_row_ptr = (int *)allocateOrExit((B.num_block_rows + 1) * sizeof(int), "block_row_ptr");
+
+    int *marker = allocateMarker(B.num_block_cols);
+
+    // first pass: count the distinct block columns of every block row, marker[J] == I means block (I, J) was already counted
+    B.block_row_ptr[0] = 0;
+    for (int I = 0; I < B.num_block_rows; I++)
+    {
+        int count = 0;
+        int last_row = (I + 1) * r < A->num_rows ? (I + 1) * r : A->num_rows;
+        for (int i = I * r; i < last_row; i++)
+        {
+            for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++)
+            {
+                int J = A->col_ind[j] / c;
+                if (marker[J] != I)
+                {
+                    marker[J] = I;
+                    count++;
+                }
+            }
+        }
+        B.block_row_ptr[I + 1] = B.block_row_ptr[I] + count;
+    }
+    B.num_blocks = B.block_row_ptr[B.num_block_rows];
+
+    B.block_col = (int *)allocateOrExit((size_t)B.num_blocks * sizeof(int), "block_col");
+    B.block_data = (double *)calloc((size_t)B.num_blocks * r * c > 0 ? (size_t)B.num_blocks * r * c : 1, sizeof(double)); // the blocks start out as zeros
+    if (B.block_data == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for block_data.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // second pass: scatter every entry into its block, marker[J] now holds the position of block J in the current block row
+    memset(marker, -1, (size_t)B.num_block_cols * sizeof(int));
+    for (int I = 0; I < B.num_block_rows; I++)
+    {
+        int row_start = B.block_row_ptr[I];
+        int next = row_start;
+        int last_row = (I + 1) * r < A->num_rows ? (I + 1) * r : A->num_rows;
+        for (int i = I * r; i < last_row; i++)
+        {
+            for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++)
+            {
+                int J = A->col_ind[j] / c;
+                if (marker[J] < row_start) // the marker is from an earlier block row (or -1), so this block is new
+                {
+                    marker[J] = next;
+                    B.block_col[next++] = J;
+                }
+                B.block_data[(size_t)marker[J] * r * c + (i - I * r) * c + (A->col_ind[j] - J * c)] += A->csr_data[j]; // += also sums duplicate entries
+            }
+        }
+    }
+
+    free(marker);
+    return B;
+}
+
+CSRMatrix bsrToCSR(const BSRMatrix *A)
+{
+    CSRMatrix C;
+    C.num_rows = A->num_rows;
+    C.num_cols = A->num_cols;
+    C.row_ptr = (int *)calloc(C.num_rows + 1, sizeof(int));
+    if (C.row_ptr == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for row_ptr.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // first pass: count the non-zeros of every row, skipping the zeros stored inside the blocks and the padding
+    for (int I = 0; I < A->num_block_rows; I++)
+    {
+        for (int b = A->block_row_ptr[I]; b < A->block_row_ptr[I + 1]; b++)
+        {
+            const double *block = A->block_data + (size_t)b * A->r * A->c;
+            for (int ii = 0; ii < A->r && I * A->r + ii < A->num_rows; ii++)
+            {
+                for (int jj = 0; jj < A->c && A->block_col[b] * A->c + jj < A->num_cols; jj++)
+                {
+                    if (block[ii * A->c + jj] != 0)
+                    {
+                        C.row_ptr[I * A->r + ii + 1]++;
+                    }
+                }
+            }
+        }
+    }
+    for (int i = 0; i < C.num_rows; i++)
+    {
+        C.row_ptr[i + 1] += C.row_ptr[i];
+    }
+    C.num_non_zeros = C.row_ptr[C.num_rows];
+
+    C.col_ind = (int *)allocateOrExit((size_t)C.num_non_zeros * sizeof(int), "col_ind");
+    C.csr_data = (double *)allocateOrExit((size_t)C.num_non_zeros * sizeof(double), "csr_data");
+    int *next_position = (int *)allocateOrExit((size_t)C.num_rows * sizeof(int), "next_position");
+    memcpy(next_position, C.row_ptr, (size_t)C.num_rows * sizeof(int));
+
+    // second pass: copy the non-zeros to their rows
+    for (int I = 0; I < A->num_block_rows; I++)
+    {
+        for (int b = A->block_row_ptr[I]; b < A->block_row_ptr[I + 1]; b++)
+        {
+            const double *block = A->block_data + (size_t)b * A->r * A->c;
+            for (int ii = 0; ii < A->r && I * A->r + ii < A->num_rows; ii++)
+            {
+                for (int jj = 0; jj < A->c && A->block_col[b] * A->c + jj < A->num_cols; jj++)
+                {
+                    if (block[ii * A->c + jj] != 0)
+                    {
+                        int dest = next_position[I * A->r + ii]++;
+                        C.col_ind[dest] = A->block_col[b] * A->c + jj;
+                        C.csr_data[dest] = block[ii * A->c + jj];
+                    }
+                }
+            }
+        }
+    }
+    free(next_position);
+
+    C.owns_data = 1;
+    C.sorted = 0; // the blocks of a block row are stored in the order they were first reached
+    return C;
+}
+
+double bsrFillRatio(const BSRMatrix *A)
+{
+    if (A->num_non_zeros == 0)
+    {
+        return 1.0;
+    }
+    return (double)A->num_blocks * A->r * A->c / A->num_non_zeros;
+}
+
+/* The kernels below are generated by macros with the block dimensions R, K and N as arguments. For the common square block
+sizes the macros are expanded with literal constants, so the compiler can fully unroll the block loops and keep the partial
+sums in registers. The Generic versions are expanded with the block sizes stored in the matrices and handle every other size. */
+
+// y = A * x for one block size, x and y must be padded to a whole number of blocks
+#define DEFINE_BSR_SPMV(NAME, R, C)                                                   \
+    static void NAME(const BSRMatrix *A, const double *x, double *y, int num_threads) \
+    {                                                                                 \
+        /* local copies of the arrays, so the compiler knows the stores to y can not change them */ \
+        const int *block_row_ptr = A->block_row_ptr;                                  \
+        const int *block_col = A->block_col;                                          \
+        const double *block_data = A->block_data;                                     \
+        _Pragma("omp parallel for schedule(static) num_threads(num_threads)")         \
+        for (int I = 0; I < A->num_block_rows; I++)                                   \
+        {                                                                             \
+            double sum[BSR_MAX_BLOCK_DIM];                                            \
+            for (int ii = 0; ii < (R); ii++)                                          \
+            {                                                                         \
+                sum[ii] = 0.0;                                                        \
+            }                                                                         \
+            for (int b = block_row_ptr[I]; b < block_row_ptr[I + 1]; b++)             \
+            {                                                                         \
+                const double *block = block_data + (size_t)b * (R) * (C);             \
+                const double *x_block = x + (size_t)block_col[b] * (C);               \
+                for (int ii = 0; ii < (R); ii++)                                      \
+                {                                                                     \
+                    for (int jj = 0; jj < (C); jj++)                                  \
+                    {                                                                 \
+                        sum[ii] += block[ii * (C) + jj] * x_block[jj];                \
+                    }                                                                 \
+                }                                                                     \
+            }                                                                         \
+            for (int ii = 0; ii < (R); ii++)                                          \
+            {                                                                         \
+                y[(size_t)I * (R) + ii] = sum[ii];                                    \
+            }                                                                         \
+        }                                                                             \
+    }
+
+DEFINE_BSR_SPMV(spmvBSR1x1, 1, 1)
+DEFINE_BSR_SPMV(spmvBSR2x2, 2, 2)
+DEFINE_BSR_SPMV(spmvBSR3x3, 3, 3)
+DEFINE_BSR_SPMV(spmvBSR4x4, 4, 4)
+DEFINE_BSR_SPMV(spmvBSRGeneric, A->r, A->c)
+
+void spmvBSR(const BSRMatrix *A, const double *x, double *y, int num_threads)
+{
+    if (num_threads < 1)
+    {
+        num_threads = 1;
+    }
+
+    // the kernels read and write whole blocks, so when the dimensions are not multiples of the block size padded copies of x and y are used
+    const double *x_used = x;
+    double *y_used = y;
+    double *x_padded = NULL, *y_padded = NULL;
+    if (A->num_cols % A->c != 0)
+    {
+        x_padded = (double *)calloc((size_t)A->num_block_cols * A->c, sizeof(double));
+        if (x_padded == NULL)
+        {
+            fprintf(stderr, "Error: Memory allocation failed for the padded x.\n");
+            exit(EXIT_FAILURE);
+        }
+        memcpy(x_padded, x, (size_t)A->num_cols * sizeof(double));
+        x_used = x_padded;
+    }
+    if (A->num_rows % A->r != 0)
+    {
+        y_padded = (double *)allocateOrExit((size_t)A->num_block_rows * A->r * sizeof(double), "the padded y");
+        y_used = y_padded;
+    }
+
+    if (A->r == 1 && A->c == 1)
+    {
+        spmvBSR1x1(A, x_used, y_used, num_threads);
+    }
+    else if (A->r == 2 && A->c == 2)
+    {
+        spmvBSR2x2(A, x_used, y_used, num_threads);
+    }
+    else if (A->r == 3 && A->c == 3)
+    {
+        spmvBSR3x3(A, x_used, y_used, num_threads);
+    }
+    else if (A->r == 4 && A->c == 4)
+    {
+        spmvBSR4x4(A, x_used, y_used, num_threads);
+    }
+    else
+    {
+        spmvBSRGeneric(A, x_used, y_used, num_threads);
+    }
+
+    if (y_padded != NULL)
+    {
+        memcpy(y, y_padded, (size_t)A->num_rows * sizeof(double));
+    }
+    free(x_padded);
+    free(y_padded);
+}
+
+// Numeric phase of A + B for one block size: C already has its block_row_ptr, every block row is filled from the union of the two rows
+#define DEFINE_BSR_ADD_NUMERIC(NAME, SIZE)                                                              \
+    static void NAME(const BSRMatrix *A, const BSRMatrix *B, BSRMatrix *C, int num_threads)             \
+    {                                                                                                   \
+        _Pragma("omp parallel num_threads(num_threads)")                                                \
+        {                                                                                               \
+            int *marker = allocateMarker(C->num_block_cols); /* every thread needs its own marker */   \
+            _Pragma("omp for schedule(dynamic, 64)")                                                    \
+            for (int I = 0; I < C->num_block_rows; I++)                                                 \
+            {                                                                                           \
+                int row_start = C->block_row_ptr[I];                                                    \
+                int next = row_start;                                                                   \
+                for (int a = A->block_row_ptr[I]; a < A->block_row_ptr[I + 1]; a++)                     \
+                {                                                                                       \
+                    marker[A->block_col[a]] = next;                                                     \
+                    C->block_col[next] = A->block_col[a];                                               \
+                    memcpy(C->block_data + (size_t)next * (SIZE), A->block_data + (size_t)a * (SIZE),   \
+                           (SIZE) * sizeof(double));                                                    \
+                    next++;                                                                             \
+                }                                                                                       \
+                for (int b = B->block_row_ptr[I]; b < B->block_row_ptr[I + 1]; b++)                     \
+                {                                                                                       \
+                    int J = B->block_col[b];                                                            \
+                    const double *b_block = B->block_data + (size_t)b * (SIZE);                         \
+                    if (marker[J] >= row_start) /* block also in A: add the two blocks */               \
+                    {                                                                                   \
+                        double *c_block = C->block_data + (size_t)marker[J] * (SIZE);                   \
+                        for (int k = 0; k < (SIZE); k++)                                                \
+                        {                                                                               \
+                            c_block[k] += b_block[k];                                                   \
+                        }                                                                               \
+                    }                                                                                   \
+                    else /* block only in B: copy it */                                                 \
+                    {                                                                                   \
+                        marker[J] = next;                                                               \
+                        C->block_col[next] = J;                                                         \
+                        memcpy(C->block_data + (size_t)next * (SIZE), b_block, (SIZE) * sizeof(double)); \
+                        next++;                                                                         \
+                    }                                                                                   \
+                }                                                                                       \
+            }                                                                                           \
+            free(marker);                                                                               \
+        }                                                                                               \
+    }
+
+DEFINE_BSR_ADD_NUMERIC(bsrAdd2x2, 4)
+DEFINE_BSR_ADD_NUMERIC(bsrAdd3x3, 9)
+DEFINE_BSR_ADD_NUMERIC(bsrAdd4x4, 16)
+DEFINE_BSR_ADD_NUMERIC(bsrAddGeneric, A->r * A->c)
+
+BSRMatrix bsrAddition(const BSRMatrix *A, const BSRMatrix *B, int num_threads)
+{
+    if (A->num_rows != B->num_rows || A->num_cols != B->num_cols || A->r != B->r || A->c != B->c)
+    {
+        fprintf(stderr, "Error: Incompatible dimensions or block sizes, please try again.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (num_threads < 1)
+    {
+        num_threads = 1;
+    }
+
+    BSRMatrix C = *A; // same dimensions and block size as A, the arrays are replaced below
+    C.block_row_ptr = (int *)allocateOrExit((C.num_block_rows + 1) * sizeof(int), "block_row_ptr");
+
+    // symbolic phase: number of distinct block columns in the union of the two block rows
+#pragma omp parallel num_threads(num_threads)
+    {
+        int *marker = allocateMarker(C.num_block_cols);
+#pragma omp for schedule(dynamic, 64)
+        for (int I = 0; I < C.num_block_rows; I++)
+        {
+            int count = A->block_row_ptr[I + 1] - A->block_row_ptr[I];
+            for (int a = A->block_row_ptr[I]; a < A->block_row_ptr[I + 1]; a++)
+            {
+                marker[A->block_col[a]] = I;
+            }
+            for (int b = B->block_row_ptr[I]; b < B->block_row_ptr[I + 1]; b++)
+            {
+                if (marker[B->block_col[b]] != I)
+                {
+                    count++;
+                }
+            }
+            C.block_row_ptr[I + 1] = count;
+        }
+        free(marker);
+    }
+    C.block_row_ptr[0] = 0;
+    for (int I = 0; I < C.num_block_rows; I++)
+    {
+        C.block_row_ptr[I + 1] += C.block_row_ptr[I];
+    }
+    C.num_blocks = C.block_row_ptr[C.num_block_rows];
+    C.block_col = (int *)allocateOrExit((size_t)C.num_blocks * sizeof(int), "block_col");
+    C.block_data = (double *)allocateOrExit((size_t)C.num_blocks * C.r * C.c * sizeof(double), "block_data");
+
+    if (C.r == 2 && C.c == 2)
+    {
+        bsrAdd2x2(A, B, &C, num_threads);
+    }
+    else if (C.r == 3 && C.c == 3)
+    {
+        bsrAdd3x3(A, B, &C, num_threads);
+    }
+    else if (C.r == 4 && C.c == 4)
+    {
+        bsrAdd4x4(A, B, &C, num_threads);
+    }
+    else
+    {
+        bsrAddGeneric(A, B, &C, num_threads);
+    }
+
+    C.num_non_zeros = C.num_blocks * C.r * C.c; // upper bound, the exact count is only known after converting back to CSR
+    return C;
+}
+
+// Numeric phase of A * B for one block size: (R x K blocks of A) times (K x N blocks of B) accumulated into R x N blocks of C
+#define DEFINE_BSR_MULTIPLY_NUMERIC(NAME, R, K, N)                                                      \
+    static void NAME(const BSRMatrix *A, const BSRMatrix *B, BSRMatrix *C, int num_threads)             \
+    {                                                                                                   \
+        _Pragma("omp parallel num_threads(num_threads)")                                                \
+        {                                                                                               \
+            int *marker = allocateMarker(C->num_block_cols);                                            \
+            _Pragma("omp for schedule(dynamic, 64)")                                                    \
+            for (int I = 0; I < C->num_block_rows; I++)                                                 \
+            {                                                                                           \
+                int row_start = C->block_row_ptr[I];                                                    \
+                int next = row_start;                                                                   \
+                for (int a = A->block_row_ptr[I]; a < A->block_row_ptr[I + 1]; a++)                     \
+                {                                                                                       \
+                    const double *a_block = A->block_data + (size_t)a * (R) * (K);                      \
+                    int k_block = A->block_col[a];                                                      \
+                    for (int b = B->block_row_ptr[k_block]; b < B->block_row_ptr[k_block + 1]; b++)     \
+                    {                                                                                   \
+                        int J = B->block_col[b];                                                        \
+                        if (marker[J] < row_start) /* first product landing in block (I, J) */          \
+                        {                                                                               \
+                            marker[J] = next;                                                           \
+                            C->block_col[next] = J;                                                     \
+                            memset(C->block_data + (size_t)next * (R) * (N), 0, (R) * (N) * sizeof(double)); \
+                            next++;                                                                     \
+                        }                                                                               \
+                        double *c_block = C->block_data + (size_t)marker[J] * (R) * (N);                \
+                        const double *b_block = B->block_data + (size_t)b * (K) * (N);                  \
+                        for (int ii = 0; ii < (R); ii++)                                                \
+                        {                                                                               \
+                            for (int kk = 0; kk < (K); kk++)                                            \
+                            {                                                                           \
+                                double a_val = a_block[ii * (K) + kk];                                  \
+                                for (int jj = 0; jj < (N); jj++)                                        \
+                                {                                                                       \
+                                    c_block[ii * (N) + jj] += a_val * b_block[kk * (N) + jj];           \
+                                }                                                                       \
+                            }                                                                           \
+                        }                                                                               \
+                    }                                                                                   \
+                }                                                                                       \
+            }                                                                                           \
+            free(marker);                                                                               \
+        }                                                                                               \
+    }
+
+DEFINE_BSR_MULTIPLY_NUMERIC(bsrMultiply2x2, 2, 2, 2)
+DEFINE_BSR_MULTIPLY_NUMERIC(bsrMultiply3x3, 3, 3, 3)
+DEFINE_BSR_MULTIPLY_NUMERIC(bsrMultiply4x4, 4, 4, 4)
+DEFINE_BSR_MULTIPLY_NUMERIC(bsrMultiplyGeneric, A->r, A->c, B->c)
+
+BSRMatrix bsrMultiplication(const BSRMatrix *A, const BSRMatrix *B, int num_threads)
+{
+    if (A->num_cols != B->num_rows || A->c != B->r)
+    {
+        fprintf(stderr, "Error: Incompatible dimensions or block sizes, please try again.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (num_threads < 1)
+    {
+        num_threads = 1;
+    }
+
+    BSRMatrix C;
+    C.r = A->r;
+    C.c = B->c;
+    C.num_rows = A->num_rows;
+    C.num_cols = B->num_cols;
+    C.num_block_rows = A->num_block_rows;
+    C.num_block_cols = B->num_block_cols;
+    C.block_row_ptr = (int *)allocateOrExit((C.num_block_rows + 1) * sizeof(int), "block_row_ptr");
+
+    // symbolic phase: count the distinct block columns reached from every block row, so the numeric phase can fill C in parallel
+#pragma omp parallel num_threads(num_threads)
+    {
+        int *marker = allocateMarker(C.num_block_cols);
+#pragma omp for schedule(dynamic, 64)
+        for (int I = 0; I < C.num_block_rows; I++)
+        {
+            int count = 0;
+            for (int a = A->block_row_ptr[I]; a < A->block_row_ptr[I + 1]; a++)
+            {
+                int k_block = A->block_col[a];
+                for (int b = B->block_row_ptr[k_block]; b < B->block_row_ptr[k_block + 1]; b++)
+                {
+                    if (marker[B->block_col[b]] != I)
+                    {
+                        marker[B->block_col[b]] = I;
+                        count++;
+                    }
+                }
+            }
+            C.block_row_ptr[I + 1] = count;
+        }
+        free(marker);
+    }
+    C.block_row_ptr[0] = 0;
+    for (int I = 0; I < C.num_block_rows; I++)
+    {
+        C.block_row_ptr[I + 1] += C.block_row_ptr[I];
+    }
+    C.num_blocks = C.block_row_ptr[C.num_block_rows];
+    C.block_col = (int *)allocateOrExit((size_t)C.num_blocks * sizeof(int), "block_col");
+    C.block_data = (double *)allocateOrExit((size_t)C.num_blocks * C.r * C.c * sizeof(double), "block_data");
+
+    if (A->r == 2 && A->c == 2 && B->c == 2)
+    {
+        bsrMultiply2x2(A, B, &C, num_threads);
+    }
+    else if (A->r == 3 && A->c == 3 && B->c == 3)
+    {
+        bsrMultiply3x3(A, B, &C, num_threads);
+    }
+    else if (A->r == 4 && A->c == 4 && B->c == 4)
+    {
+        bsrMultiply4x4(A, B, &C, num_threads);
+    }
+    else
+    {
+        bsrMultiplyGeneric(A, B, &C, num_threads);
+    }
+
+    C.num_non_zeros = C.num_blocks * C.r * C.c; // upper bound, the exact count is only known after converting back to CSR
+    return C;
+}
+
+void suggestBlockSize(const CSRMatrix *A, int *r, int *c, double *estimated_fill)
+{
+    static const int candidates[] = {1, 2, 3, 4, 6, 8};
+    int num_candidates = (int)(sizeof(candidates) / sizeof(candidates[0]));
+
+    // plain CSR moves a value and a column index per entry plus a row pointer per row, this is the cost to beat
+    double best_cost = (double)A->num_non_zeros * (sizeof(double) + sizeof(int)) + (double)A->num_rows * sizeof(int);
+    *r = 1;
+    *c = 1;
+    *estimated_fill = 1.0;
+
+    int *marker = allocateMarker(A->num_cols > 0 ? A->num_cols : 1); // big enough for every block column count
+    for (int ri = 0; ri < num_candidates; ri++)
+    {
+        int block_rows = candidates[ri];
+        int num_block_rows = (A->num_rows + block_rows - 1) / block_rows;
+        int stride = num_block_rows / BSR_SAMPLED_BLOCK_ROWS > 1 ? num_block_rows / BSR_SAMPLED_BLOCK_ROWS : 1; // sample evenly spaced block rows
+
+        for (int ci = 0; ci < num_candidates; ci++)
+        {
+            int block_cols = candidates[ci];
+            if (block_rows == 1 && block_cols == 1)
+            {
+                continue; // that is plain CSR
+            }
+
+            // count the blocks and the non-zeros in the sampled block rows, the marker trick from csrToBSR() finds the distinct blocks
+            long long sampled_blocks = 0, sampled_non_zeros = 0;
+            int sample_id = 0;
+            for (int I = 0; I < num_block_rows; I += stride, sample_id++)
+            {
+                int last_row = (I + 1) * block_rows < A->num_rows ? (I + 1) * block_rows : A->num_rows;
+                for (int i = I * block_rows; i < last_row; i++)
+                {
+                    for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++)
+                    {
+                        int J = A->col_ind[j] / block_cols;
+                        if (marker[J] != sample_id)
+                        {
+                            marker[J] = sample_id;
+                            sampled_blocks++;
+                        }
+                        sampled_non_zeros++;
+                    }
+                }
+            }
+            memset(marker, -1, (size_t)(A->num_cols > 0 ? A->num_cols : 1) * sizeof(int)); // sample ids restart for the next candidate
+
+            if (sampled_non_zeros == 0)
+            {
+                continue;
+            }
+            double fill = (double)sampled_blocks * block_rows * block_cols / sampled_non_zeros;
+            double blocks = (double)A->num_non_zeros * fill / (block_rows * block_cols); // estimated number of stored blocks
+            double cost = blocks * (block_rows * block_cols * sizeof(double) + sizeof(int)) + (double)num_block_rows * sizeof(int);
+            if (cost < best_cost)
+            {
+                best_cost = cost;
+                *r = block_rows;
+                *c = block_cols;
+                *estimated_fill = fill;
+            }
+        }
+    }
+    free(marker);
+}
+
+void freeBSRMatrix(BSRMatrix *A)
+{
+    free(A->block_data);
+    free(A->block_col);
+    free(A->block_row_ptr);
+    A->block_data = NULL;
+    A->block_col = NULL;
+    A->block_row_ptr = NULL;
+    A->num_blocks = 0;
+    A->num_block_rows = 0;
+    A->num_block_cols = 0;
+    A->num_rows = 0;
+    A->num_cols = 0;
+    A->num_non_zeros = 0;
+}
@@ -0,0 +1,33 @@
+#ifndef BSR_H
+#define BSR_H
+
+#include "functions.h" // needed for the CSRMatrix struct
+
+/* Block compressed sparse row (BSR) matrix. The matrix is cut into r x c blocks and every block that contains at least one
+non-zero is stored as a small dense block, so one column index is stored per block instead of per entry. This pays off for
+matrices made of small dense blocks (FEM matrices with several unknowns per node), at the price of storing the explicit zeros
+inside the stored blocks. When the dimensions are not multiples of the block size the last block row/column is padded with zeros. */
+typedef struct {
+    double *block_data;   // Values of the stored blocks, r * c values per block in row-major order
+    int *block_col;       // Block column index of every stored block
+    int *block_row_ptr;   // Start of every block row in block_col (num_block_rows + 1 entries)
+    int num_blocks;       // Number of stored blocks
+    int num_block_rows;   // Number of block rows, ceil(num_rows / r)
+    int num_block_cols;   // Number of block columns, ceil(num_cols / c)
+    int r;                // Rows per block
+    int c;                // Columns per block
+    int num_rows;         // Number of rows of the original matrix
+    int num_cols;         // Number of columns of the original matrix
+    int num_non_zeros;    // Number of non-zeros of the original matrix (the blocks store num_blocks * r * c values)
+} BSRMatrix;
+
+BSRMatrix csrToBSR(const CSRMatrix *A, int r, int c); // converts A into r x c blocks
+CSRMatrix bsrToCSR(const BSRMatrix *A);               // converts back to CSR, the zeros stored inside the blocks are dropped
+double bsrFillRatio(const BSRMatrix *A);              // stored values / original non-zeros, 1.0 means the blocks contain no padding at all
+void spmvBSR(const BSRMatrix *A, const double *x, double *y, int num_threads); // y = A * x
+BSRMatrix bsrAddition(const BSRMatrix *A, const BSRMatrix *B, int num_threads); // A + B, both matrices need the same dimensions and block size
+BSRMatrix bsrMultiplication(const BSRMatrix *A, const BSRMatrix *B, int num_threads); // A * B, the block columns of A must match the block rows of B
+void suggestBlockSize(const CSRMatrix *A, int *r, int *c, double *estimated_fill); // picks the block size with the least estimated memory traffic
+void freeBSRMatrix(BSRMatrix *A); // frees the memory of a BSR matrix
+
+#endif
@@ -0,0 +1,452 @@
+#include <stdio.h>     // the standard c library
+#include "cache.h"     // reference the header file with the result cache declarations
+#include "mmwriter.h"  // writeCSRArrays() and ReadCSRArrays() store the results
+#include <stdlib.h>    // provides memory allocation functions and realpath()
+#include <string.h>    // provides strcmp(), strlen() and memcpy()
+#include <errno.h>     // provides errno to tell an existing directory from a failed mkdir()
+#include <limits.h>    // provides PATH_MAX
+#include <unistd.h>    // provides getpid() for unique temporary file names
+#include <sys/stat.h>  // provides stat() and mkdir()
+
+#define HASH_CHUNK_BYTES (1 << 16)              // arrays are hashed in chunks of this size, one chunk per iteration of the parallel loop
+#define HASH_PRIME 0x9e3779b97f4a7c15ULL        // odd 64 bit constant that spreads the bits of every word over the whole state
+#define STAMP_FILE "stamps"                     // one line per input file: hash, modification time, size, load flags and path
+#define STATISTICS_FILE "statistics"            // hits and misses of all runs that used the directory
+
+// Finaliser of MurmurHash3, every input bit affects every output bit
+static unsigned long long mix(unsigned long long h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Hashes length bytes eight at a time, the last partial word is padded with zeros
+static unsigned long long hashBytes(const unsigned char *bytes, size_t length, unsigned long long seed)
+{
+    unsigned long long h = mix(seed + length * HASH_PRIME);
+    size_t words = length / 8;
+    for (size_t w = 0; w < words; w++)
+    {
+        unsigned long long word;
+        memcpy(&word, bytes + 8 * w, 8); // memcpy instead of a cast because the arrays are only 4 byte aligned inside a chunk
+        h = (h ^ word) * HASH_PRIME;
+        h ^= h >> 29;
+    }
+    if (length % 8 != 0)
+    {
+        unsigned long long word = 0;
+        memcpy(&word, bytes + 8 * words, length % 8);
+        h = (h ^ word) * HASH_PRIME;
+    }
+    return mix(h);
+}
+
+/* The chunks are hashed in parallel and their hashes are combined in order. The chunk size is fixed, so the hash does not
+depend on the number of threads. */
+static unsigned long long hashArray(const void *data, size_t length, int num_threads)
+{
+    long long num_chunks = (long long)((length + HASH_CHUNK_BYTES - 1) / HASH_CHUNK_BYTES);
+    if (num_chunks == 0)
+    {
+        return mix(HASH_PRIME);
+    }
+    unsigned long long *chunk_hashes = (unsigned long long *)malloc(num_chunks * sizeof(unsigned long long));
+    if (chunk_hashes == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for hashing a matrix.\n");
+        exit(EXIT_FAILURE);
+    }
+
+#pragma omp parallel for schedule(static) num_threads(num_threads)
+    for (long long c = 0; c < num_chunks; c++)
+    {
+        size_t start = (size_t)c * HASH_CHUNK_BYTES;
+        size_t chunk_length = length - start < HASH_CHUNK_BYTES ? length - start : HASH_CHUNK_BYTES;
+        chunk_hashes[c] = hashBytes((const unsigned char *)data + start, chunk_length, (unsigned long long)c);
+    }
+
+    unsigned long long h = 0;
+    for (long long c = 0; c < num_chunks; c++)
+    {
+        h = mix(h ^ chunk_hashes[c]) + HASH_PRIME;
+    }
+    free(chunk_hashes);
+    return h;
+}
+
+unsigned long long hashMatrix(const CSRMatrix *matrix, int num_threads)
+{
+    if (num_threads < 1)
+    {
+        num_threads = 1;
+    }
+    size_t nnz = (size_t)matrix->num_non_zeros;
+    unsigned long long h = mix(((unsigned long long)(unsigned)matrix->num_rows << 32) | (unsigned)matrix->num_cols);
+    h = mix(h ^ (unsigned)matrix->num_non_zeros);
+    h = mix(h ^ hashArray(matrix->row_ptr, ((size_t)matrix->num_rows + 1) * sizeof(int), num_threads));
+    h = mix(h ^ hashArray(matrix->col_ind, nnz * sizeof(int), num_threads));
+    h = mix(h ^ hashArray(matrix->csr_data, nnz * sizeof(double), num_threads));
+    return h;
+}
+
+unsigned long long resultKey(const char *operation, const unsigned long long *input_hashes, int count)
+{
+    unsigned long long h = hashBytes((const unsigned char *)operation, strlen(operation), (unsigned long long)count);
+    for (int k = 0; k < count; k++)
+    {
+        h = mix(h ^ input_hashes[k]) + HASH_PRIME; // order matters, A * B and B * A are different results
+    }
+    return h;
+}
+
+// Writes directory/name into path
+static void cachePath(const ResultCache *cache, const char *name, char *path)
+{
+    if (snprintf(path, PATH_MAX, "%s/%s", cache->directory, name) >= PATH_MAX)
+    {
+        fprintf(stderr, "Error: The cache directory %s has a too long path.\n", cache->directory);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Path of the file holding the result with the given key
+static void resultPath(const ResultCache *cache, unsigned long long key, char *path)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.csr", key);
+    cachePath(cache, name, path);
+}
+
+// Name of the temporary file that path is written to first, the process id keeps runs that overlap apart
+static void temporaryPath(const char *path, char *temporary)
+{
+    if (snprintf(temporary, PATH_MAX + 32, "%s.%ld", path, (long)getpid()) >= PATH_MAX + 32)
+    {
+        fprintf(stderr, "Error: The cache file %s has a too long path.\n", path);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Moves a completely written temporary file into place, so other runs never see half of a file
+static void replaceFile(const char *temporary, const char *path)
+{
+    if (rename(temporary, path) != 0)
+    {
+        fprintf(stderr, "Error: Failed to move %s to %s\n", temporary, path);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Adds a stamp to the list, path is copied
+static void appendStamp(ResultCache *cache, const InputStamp *stamp)
+{
+    if (cache->num_stamps == cache->stamp_capacity)
+    {
+        cache->stamp_capacity = cache->stamp_capacity > 0 ? 2 * cache->stamp_capacity : 16;
+        cache->stamps = (InputStamp *)realloc(cache->stamps, cache->stamp_capacity * sizeof(InputStamp));
+        if (cache->stamps == NULL)
+        {
+            fprintf(stderr, "Error: Memory allocation failed for the cache stamps.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    InputStamp *added = &cache->stamps[cache->num_stamps++];
+    *added = *stamp;
+    added->path = (char *)malloc(strlen(stamp->path) + 1);
+    if (added->path == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for the cache stamps.\n");
+        exit(EXIT_FAILURE);
+    }
+    strcpy(added->path, stamp->path);
+}
+
+void openResultCache(ResultCache *cache, const char *directory)
+{
+    cache->directory = directory;
+    cache->stamps = NULL;
+    cache->num_stamps = 0;
+    cache->stamp_capacity = 0;
+    cache->stamps_changed = 0;
+    cache->hits = 0;
+    cache->misses = 0;
+    cache->hashes_reused = 0;
+    cache->hashes_computed = 0;
+    cache->total_hits = 0;
+    cache->total_misses = 0;
+    cache->hash_time = 0.0;
+    cache->lookup_time = 0.0;
+    cache->store_time = 0.0;
+
+    if (mkdir(directory, 0777) != 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "Error: Failed to create the cache directory %s\n", directory);
+        exit(EXIT_FAILURE);
+    }
+
+    char path[PATH_MAX];
+    cachePath(cache, STAMP_FILE, path);
+    FILE *file = fopen(path, "r");
+    if (file != NULL) // no stamp file yet is a normal empty cache
+    {
+        char line[PATH_MAX + 128];
+        while (fgets(line, sizeof(line), file) != NULL)
+        {
+            InputStamp stamp;
+            int path_start = 0;
+            line[strcspn(line, "\n")] = '\0';
+            if (sscanf(line, "%llx %lld %lld %lld %d %n", &stamp.hash, &stamp.mtime_sec, &stamp.mtime_nsec, &stamp.size,
+                       &stamp.load_flags, &path_start) == 5 && path_start > 0 && line[path_start] != '\0')
+            {
+                stamp.path = line + path_start;
+                appendStamp(cache, &stamp);
+            }
+        }
+        fclose(file);
+    }
+
+    cachePath(cache, STATISTICS_FILE, path);
+    file = fopen(path, "r");
+    if (file != NULL)
+    {
+        if (fscanf(file, "hits %lld misses %lld", &cache->total_hits, &cache->total_misses) != 2)
+        {
+            cache->total_hits = 0; // a damaged statistics file only restarts the counts
+            cache->total_misses = 0;
+        }
+        fclose(file);
+    }
+}
+
+void closeResultCache(ResultCache *cache)
+{
+    char path[PATH_MAX], temporary[PATH_MAX + 32];
+
+    /* The totals were read when the cache was opened, so two runs that overlap can lose each other's counts. They are meant as a
+    rough picture of how often the cache pays off, the results themselves are never affected. */
+    cache->total_hits += cache->hits;
+    cache->total_misses += cache->misses;
+    cachePath(cache, STATISTICS_FILE, path);
+    temporaryPath(path, temporary);
+    FILE *file = fopen(temporary, "w");
+    if (file == NULL || fprintf(file, "hits %lld misses %lld\n", cache->total_hits, cache->total_misses) < 0 || fclose(file) != 0)
+    {
+        fprintf(stderr, "Error: Failed to write to %s\n", temporary);
+        exit(EXIT_FAILURE);
+    }
+    replaceFile(temporary, path);
+
+    if (cache->stamps_changed)
+    {
+        cachePath(cache, STAMP_FILE, path);
+        temporaryPath(path, temporary);
+        file = fopen(temporary, "w");
+        if (file == NULL)
+        {
+            fprintf(stderr, "Error: Failed to open %s for writing\n", temporary);
+            exit(EXIT_FAILURE);
+        }
+        for (int s = 0; s < cache->num_stamps; s++)
+        {
+            const InputStamp *stamp = &cache->stamps[s];
+            fprintf(file, "%016llx %lld %lld %lld %d %s\n", stamp->hash, stamp->mtime_sec, stamp->mtime_nsec, stamp->size,
+                    stamp->load_flags, stamp->path);
+        }
+        if (fclose(file) != 0)
+        {
+            fprintf(stderr, "Error: Failed to write to %s\n", temporary);
+            exit(EXIT_FAILURE);
+        }
+        replaceFile(temporary, path);
+    }
+
+    for (int s = 0; s < cache->num_stamps; s++)
+    {
+        free(cache->stamps[s].path);
+    }
+    free(cache->stamps);
+    cache->stamps = NULL;
+    cache->num_stamps = 0;
+    cache->stamp_capacity = 0;
+}
+
+/* Fills in everything of the stamp of a file except the hash. Returns 0 when the file can not be found, the caller then simply
+treats it as unstamped and the loader reports the missing file. */
+static int describeFile(const char *filename, const LoadOptions *load, char *absolute_path, InputStamp *stamp)
+{
+    struct stat info;
+    if (realpath(filename, absolute_path) == NULL || stat(absolute_path, &info) != 0)
+    {
+        return 0;
+    }
+    stamp->path = absolute_path;
+    stamp->mtime_sec = (long long)info.st_mtim.tv_sec;
+    stamp->mtime_nsec = (long long)info.st_mtim.tv_nsec;
+    stamp->size = (long long)info.st_size;
+    stamp->load_flags = (load->sum_duplicates ? 1 : 0) + (load->drop_zeros ? 2 : 0); // the same file gives other arrays with other load options
+    stamp->hash = 0;
+    return 1;
+}
+
+// Position of the stamp for this path and these load options, -1 when there is none
+static int findStamp(const ResultCache *cache, const InputStamp *file)
+{
+    for (int s = 0; s < cache->num_stamps; s++)
+    {
+        if (cache->stamps[s].load_flags == file->load_flags && strcmp(cache->stamps[s].path, file->path) == 0)
+        {
+            return s;
+        }
+    }
+    return -1;
+}
+
+// Takes the hash of a file from its stamp, 1 when the file has not been modified since it was stamped
+static int stampedHash(const ResultCache *cache, const char *filename, const LoadOptions *load, unsigned long long *hash)
+{
+    char absolute_path[PATH_MAX];
+    InputStamp file;
+    if (!describeFile(filename, load, absolute_path, &file))
+    {
+        return 0;
+    }
+    int s = findStamp(cache, &file);
+    if (s < 0 || cache->stamps[s].mtime_sec != file.mtime_sec || cache->stamps[s].mtime_nsec != file.mtime_nsec ||
+        cache->stamps[s].size != file.size)
+    {
+        return 0;
+    }
+    *hash = cache->stamps[s].hash;
+    return 1;
+}
+
+// Hash of a loaded input, from its stamp when the file is unchanged, otherwise computed and stamped
+static unsigned long long inputHash(ResultCache *cache, const char *filename, const LoadOptions *load, const CSRMatrix *matrix, int num_threads)
+{
+    unsigned long long hash;
+    if (stampedHash(cache, filename, load, &hash))
+    {
+        cache->hashes_reused++;
+        return hash;
+    }
+
+    double start_time = wallTime();
+    hash = hashMatrix(matrix, num_threads);
+    cache->hash_time += wallTime() - start_time;
+    cache->hashes_computed++;
+
+    char absolute_path[PATH_MAX];
+    InputStamp file;
+    if (describeFile(filename, load, absolute_path, &file))
+    {
+        file.hash = hash;
+        int s = findStamp(cache, &file);
+        if (s >= 0) // the file changed since it was stamped
+        {
+            char *path = cache->stamps[s].path;
+            cache->stamps[s] = file;
+            cache->stamps[s].path = path;
+        }
+        else
+        {
+            appendStamp(cache, &file);
+        }
+        cache->stamps_changed = 1;
+    }
+    return hash;
+}
+
+/* Reads the result with the given key, 0 when there is none. Results are moved into place only once they are completely
+written, the magic and size checks only guard against files that were damaged or replaced by something outside of this
+program. Such a file counts as a miss, and ReadCSRArrays() only sees files it will accept. */
+static int readResult(ResultCache *cache, unsigned long long key, CSRMatrix *result)
+{
+    double start_time = wallTime();
+    char path[PATH_MAX];
+    resultPath(cache, key, path);
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        cache->lookup_time += wallTime() - start_time;
+        return 0;
+    }
+    char magic[4];
+    int dimensions[3];
+    struct stat info;
+    int complete = fread(magic, 1, 4, file) == 4 && memcmp(magic, CSR_ARRAYS_MAGIC, 4) == 0 && fread(dimensions, sizeof(int), 3, file) == 3 && fstat(fileno(file), &info) == 0 &&
+                   dimensions[0] >= 0 && dimensions[2] >= 0 &&
+                   (long long)info.st_size == 16 + 4LL * (dimensions[0] + 1) + 12LL * dimensions[2]; // header, row_ptr, col_ind and csr_data
+    fclose(file);
+    if (complete)
+    {
+        ReadCSRArrays(path, result);
+    }
+    cache->lookup_time += wallTime() - start_time;
+    return complete;
+}
+
+int cachedResult(ResultCache *cache, const char *operation, char *const filenames[], const CSRMatrix *const inputs[], int count,
+                 const LoadOptions *load, int num_threads, unsigned long long *key, CSRMatrix *result)
+{
+    unsigned long long *hashes = (unsigned long long *)malloc((count > 0 ? count : 1) * sizeof(unsigned long long));
+    if (hashes == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for the input hashes.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int k = 0; k < count; k++)
+    {
+        hashes[k] = inputHash(cache, filenames[k], load, inputs[k], num_threads);
+    }
+    *key = resultKey(operation, hashes, count);
+    free(hashes);
+
+    if (readResult(cache, *key, result))
+    {
+        cache->hits++;
+        return 1;
+    }
+    cache->misses++;
+    return 0;
+}
+
+int stampedResult(ResultCache *cache, const char *operation, char *const filenames[], int count, const LoadOptions *load, CSRMatrix *result)
+{
+    unsigned long long *hashes = (unsigned long long *)malloc((count > 0 ? count : 1) * sizeof(unsigned long long));
+    if (hashes == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for the input hashes.\n");
+        exit(EXIT_FAILURE);
+    }
+    int stamped = 1;
+    for (int k = 0; k < count && stamped; k++)
+    {
+        stamped = stampedHash(cache, filenames[k], load, &hashes[k]);
+    }
+    unsigned long long key = stamped ? resultKey(operation, hashes, count) : 0;
+    free(hashes);
+
+    // a miss is not counted here, the caller loads the inputs and goes through cachedResult() which counts it
+    if (stamped && readResult(cache, key, result))
+    {
+        cache->hashes_reused += count;
+        cache->hits++;
+        return 1;
+    }
+    return 0;
+}
+
+void storeResult(ResultCache *cache, unsigned long long key, const CSRMatrix *result)
+{
+    double start_time = wallTime();
+    char path[PATH_MAX], temporary[PATH_MAX + 32];
+    resultPath(cache, key, path);
+    temporaryPath(path, temporary);
+    writeCSRArrays(temporary, result);
+    replaceFile(temporary, path);
+    cache->store_time += wallTime() - start_time;
+}
@@ -0,0 +1,47 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "functions.h" // needed for the CSRMatrix and LoadOptions structs
+
+/* On-disk cache of operation results. A result is stored under a key made from a hash of the CSR arrays of every input and a
+description of the operation, so it is found again no matter where the inputs were loaded from and never matches changed
+inputs. The cache directory also keeps a stamp per input file (modification time, size, load options and the hash of the
+loaded arrays): while the stamp still matches, the hash is taken from it and the file does not have to be read to find a result. */
+
+// What the cache remembers about one input file
+typedef struct {
+    char *path;                // absolute path of the file
+    long long mtime_sec;       // modification time of the file when it was hashed, seconds
+    long long mtime_nsec;      // and nanoseconds
+    long long size;            // size of the file in bytes when it was hashed
+    int load_flags;            // LoadOptions the file was loaded with, sum_duplicates + 2 * drop_zeros
+    unsigned long long hash;   // hashMatrix() of the loaded matrix
+} InputStamp;
+
+typedef struct {
+    const char *directory;     // where the results, the stamps and the statistics are kept
+    InputStamp *stamps;        // stamps read from the directory plus the ones added in this run
+    int num_stamps;
+    int stamp_capacity;
+    int stamps_changed;        // 1 when the stamp file has to be written back
+    int hits;                  // lookups of this run that found their result
+    int misses;                // lookups of this run that had to compute the result
+    int hashes_reused;         // input hashes taken from a stamp
+    int hashes_computed;       // input hashes computed from the loaded arrays
+    long long total_hits;      // hits of every run that used the directory, including this one
+    long long total_misses;    // misses of every run that used the directory, including this one
+    double hash_time;          // wall time spent hashing inputs
+    double lookup_time;        // wall time spent finding and reading results
+    double store_time;         // wall time spent writing results
+} ResultCache;
+
+void openResultCache(ResultCache *cache, const char *directory); // creates the directory if needed and reads the stamps and statistics
+void closeResultCache(ResultCache *cache); // writes back the stamps and statistics and frees the stamps
+unsigned long long hashMatrix(const CSRMatrix *matrix, int num_threads); // 64 bit hash of the dimensions and the three arrays, the same for any num_threads
+unsigned long long resultKey(const char *operation, const unsigned long long *input_hashes, int count); // key of a result, operation should name every option that changes it
+int cachedResult(ResultCache *cache, const char *operation, char *const filenames[], const CSRMatrix *const inputs[], int count,
+                 const LoadOptions *load, int num_threads, unsigned long long *key, CSRMatrix *result); // 1 and the result on a hit, 0 and the key to store under on a miss
+int stampedResult(ResultCache *cache, const char *operation, char *const filenames[], int count, const LoadOptions *load, CSRMatrix *result); // same lookup from the stamps alone, 1 only on a hit
+void storeResult(ResultCache *cache, unsigned long long key, const CSRMatrix *result); // writes the result computed after a miss
+
+#endif
@@ -0,0 +1,438 @@
+#include <stdio.h>     // the standard c library
+#include "chain.h"     // reference the header file with the chain product declarations
+#include "estimate.h"  // exact flops and sampled non-zero estimates of single products
+#include <stdlib.h>    // provides memory allocation functions
+#include <string.h>    // provides memset()
+#include <math.h>      // provides exp() for the density model and fabs() for the drop tolerance
+
+#define PAIR_SAMPLED_ROWS 256 // rows sampled when estimating the size of a product of two input matrices
+
+/* Buffers that every multiplication of a chain needs and that only depend on the number of columns of the result, so they are
+allocated once and reused for all steps instead of being allocated (and, for multiplication(), oversized) at every step. */
+typedef struct {
+    int *marker;          // column marker, same idea as in multiplication()
+    double *accumulator;  // dense accumulator for the values of the current row
+    int capacity;         // number of columns the two arrays can hold
+} ChainWorkspace;
+
+// Makes sure the workspace can hold num_cols columns, growing it only when a wider matrix shows up
+static void reserveWorkspace(ChainWorkspace *workspace, int num_cols)
+{
+    if (num_cols <= workspace->capacity)
+    {
+        return;
+    }
+    free(workspace->marker);
+    free(workspace->accumulator);
+    workspace->marker = (int *)malloc((size_t)num_cols * sizeof(int));
+    workspace->accumulator = (double *)malloc((size_t)num_cols * sizeof(double));
+    if (workspace->marker == NULL || workspace->accumulator == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for the chain workspace.\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(workspace->marker, -1, (size_t)num_cols * sizeof(int));
+    workspace->capacity = num_cols;
+}
+
+// CSR memory of a matrix
+static size_t matrixBytes(const CSRMatrix *A)
+{
+    return (size_t)A->num_non_zeros * (sizeof(double) + sizeof(int)) + (size_t)(A->num_rows + 1) * sizeof(int);
+}
+
+/* C = A * B using the workspace. A symbolic pass counts the entries of every row first, so the result arrays are allocated with
+their exact size instead of a fixed worst case buffer. The numeric pass accumulates every row in the dense accumulator, then the
+entries with |value| <= drop_tolerance are dropped while the row is written, the same rule as pruneRow(). */
+static CSRMatrix multiplyReusing(const CSRMatrix *A, const CSRMatrix *B, double drop_tolerance, ChainWorkspace *workspace)
+{
+    if (A->num_cols != B->num_rows)
+    {
+        fprintf(stderr, "Error: Incompatible dimensions, please try again.\n");
+        exit(EXIT_FAILURE);
+    }
+    reserveWorkspace(workspace, B->num_cols);
+    int *marker = workspace->marker;
+    double *accumulator = workspace->accumulator;
+
+    CSRMatrix C;
+    C.num_rows = A->num_rows;
+    C.num_cols = B->num_cols;
+    C.row_ptr = (int *)malloc((C.num_rows + 1) * sizeof(int));
+    if (C.row_ptr == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for row_ptr.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // symbolic pass: marker[col] == i means col was already counted for row i
+    long long total = 0;
+    C.row_ptr[0] = 0;
+    for (int i = 0; i < A->num_rows; i++)
+    {
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++)
+        {
+            int a_col = A->col_ind[j];
+            for (int k = B->row_ptr[a_col]; k < B->row_ptr[a_col + 1]; k++)
+            {
+                if (marker[B->col_ind[k]] != i)
+                {
+                    marker[B->col_ind[k]] = i;
+                    total++;
+                }
+            }
+        }
+        C.row_ptr[i + 1] = (int)total;
+    }
+    if (total > 2147483647LL) // the CSR arrays use int indices
+    {
+        fprintf(stderr, "Error: The product has more non-zeros than a CSR matrix can hold.\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(marker, -1, (size_t)C.num_cols * sizeof(int)); // leave the marker clean for the numeric pass and the next step
+
+    C.col_ind = (int *)malloc((total > 0 ? total : 1) * sizeof(int));
+    C.csr_data = (double *)malloc((total > 0 ? total : 1) * sizeof(double));
+    if (C.col_ind == NULL || C.csr_data == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for the product.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // numeric pass: collect the columns of the row in col_ind and their sums in the accumulator, then write the ones above the tolerance
+    int write = 0;
+    for (int i = 0; i < A->num_rows; i++)
+    {
+        int row_start = C.row_ptr[i]; // symbolic start of the row, the row is written from position write <= row_start
+        int row_end = row_start;
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++)
+        {
+            int a_col = A->col_ind[j];
+            double a_val = A->csr_data[j];
+            for (int k = B->row_ptr[a_col]; k < B->row_ptr[a_col + 1]; k++)
+            {
+                int b_col = B->col_ind[k];
+                if (marker[b_col] != i)
+                {
+                    marker[b_col] = i;
+                    accumulator[b_col] = a_val * B->csr_data[k];
+                    C.col_ind[row_end++] = b_col;
+                }
+                else
+                {
+                    accumulator[b_col] += a_val * B->csr_data[k];
+                }
+            }
+        }
+
+        C.row_ptr[i] = write;
+        for (int j = row_start; j < row_end; j++)
+        {
+            int col = C.col_ind[j];
+            if (fabs(accumulator[col]) > drop_tolerance) // drop the entries that cancelled out or fell below the tolerance
+            {
+                C.col_ind[write] = col;
+                C.csr_data[write] = accumulator[col];
+                write++;
+            }
+        }
+    }
+    C.row_ptr[C.num_rows] = write;
+    C.num_non_zeros = write;
+    C.sorted = 0; // columns are in the order they were first reached, like multiplication()
+    C.owns_data = 1;
+    memset(marker, -1, (size_t)C.num_cols * sizeof(int));
+
+    if (write < total) // give back the space of the dropped entries
+    {
+        int *col_ind = (int *)realloc(C.col_ind, (write > 0 ? write : 1) * sizeof(int));
+        double *csr_data = (double *)realloc(C.csr_data, (write > 0 ? write : 1) * sizeof(double));
+        if (col_ind != NULL)
+        {
+            C.col_ind = col_ind;
+        }
+        if (csr_data != NULL)
+        {
+            C.csr_data = csr_data;
+        }
+    }
+    return C;
+}
+
+// Bookkeeping for a new intermediate product
+static void recordProduct(ChainStats *stats, const CSRMatrix *P, long long flops, size_t *live_bytes)
+{
+    stats->multiplications++;
+    stats->total_flops += flops;
+    if (P->num_non_zeros > stats->peak_non_zeros)
+    {
+        stats->peak_non_zeros = P->num_non_zeros;
+    }
+    *live_bytes += matrixBytes(P);
+    if (*live_bytes > stats->peak_bytes)
+    {
+        stats->peak_bytes = *live_bytes;
+    }
+}
+
+double chainOrder(const CSRMatrix *const *matrices, int count, int *split)
+{
+    for (int i = 0; i + 1 < count; i++)
+    {
+        if (matrices[i]->num_cols != matrices[i + 1]->num_rows)
+        {
+            fprintf(stderr, "Error: Incompatible dimensions in the chain, please try again.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    double *cost = (double *)calloc((size_t)count * count, sizeof(double));
+    double *nnz = (double *)calloc((size_t)count * count, sizeof(double)); // estimated non-zeros of the product of matrices i..j
+    if (cost == NULL || nnz == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for the chain order.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        nnz[i * count + i] = matrices[i]->num_non_zeros;
+        split[i * count + i] = i;
+    }
+
+    /* Sparse version of the matrix chain ordering dynamic program. Multiplying the products (i..k) and (k+1..j) costs its flops
+    plus writing its result. For two input matrices the flops are counted exactly and the size is estimated by sampling. For longer
+    intervals the operands only exist as estimates, so a uniform random model is used: the flops are nnz(L) * nnz(R) / inner
+    dimension, and each of the m * p entries of the result is non-zero with probability 1 - exp(-flops / (m * p)). */
+    for (int length = 2; length <= count; length++)
+    {
+        for (int i = 0; i + length - 1 < count; i++)
+        {
+            int j = i + length - 1;
+            double m = matrices[i]->num_rows, p = matrices[j]->num_cols;
+            cost[i * count + j] = -1.0;
+            for (int k = i; k < j; k++)
+            {
+                double flops, product_nnz;
+                if (length == 2)
+                {
+                    ProductEstimate estimate = estimateProduct(matrices[i], matrices[j], PAIR_SAMPLED_ROWS, 12345u);
+                    flops = (double)estimate.flops;
+                    product_nnz = estimate.estimate;
+                }
+                else
+                {
+                    double inner = matrices[k]->num_cols > 0 ? matrices[k]->num_cols : 1;
+                    flops = nnz[i * count + k] * nnz[(k + 1) * count + j] / inner;
+                    product_nnz = m * p > 0 ? m * p * (1.0 - exp(-flops / (m * p))) : 0.0;
+                }
+
+                double total = cost[i * count + k] + cost[(k + 1) * count + j] + flops + product_nnz;
+                if (cost[i * count + j] < 0 || total < cost[i * count + j])
+                {
+                    cost[i * count + j] = total;
+                    nnz[i * count + j] = product_nnz;
+                    split[i * count + j] = k;
+                }
+            }
+        }
+    }
+
+    double best = count > 0 ? cost[count - 1] : 0.0; // entry (0, count - 1)
+    free(cost);
+    free(nnz);
+    return best;
+}
+
+// Appends the parenthesised order of matrices i..j to buffer
+static void describeInterval(const int *split, int count, int i, int j, char *buffer, size_t size)
+{
+    size_t used = strlen(buffer);
+    if (i == j)
+    {
+        snprintf(buffer + used, size - used, "M%d", i + 1);
+        return;
+    }
+    snprintf(buffer + used, size - used, "(");
+    describeInterval(split, count, i, split[i * count + j], buffer, size);
+    used = strlen(buffer);
+    snprintf(buffer + used, size - used, "*");
+    describeInterval(split, count, split[i * count + j] + 1, j, buffer, size);
+    used = strlen(buffer);
+    snprintf(buffer + used, size - used, ")");
+}
+
+void describeChainOrder(const int *split, int count, char *buffer, size_t size)
+{
+    if (size == 0)
+    {
+        return;
+    }
+    buffer[0] = '\0';
+    if (count > 0)
+    {
+        describeInterval(split, count, 0, count - 1, buffer, size);
+    }
+}
+
+// Computes the product of matrices i..j following the split table. *owned tells the caller whether the result must be freed
+static CSRMatrix executeInterval(const CSRMatrix *const *matrices, const int *split, int count, int i, int j, double drop_tolerance,
+                                 ChainWorkspace *workspace, ChainStats *stats, size_t *live_bytes, int *owned)
+{
+    if (i == j)
+    {
+        *owned = 0; // an input matrix, it belongs to the caller of chainProduct()
+        return *matrices[i];
+    }
+
+    int k = split[i * count + j];
+    int left_owned, right_owned;
+    CSRMatrix left = executeInterval(matrices, split, count, i, k, drop_tolerance, workspace, stats, live_bytes, &left_owned);
+    CSRMatrix right = executeInterval(matrices, split, count, k + 1, j, drop_tolerance, workspace, stats, live_bytes, &right_owned);
+
+    CSRMatrix product = multiplyReusing(&left, &right, drop_tolerance, workspace);
+    recordProduct(stats, &product, productFlops(&left, &right), live_bytes);
+
+    // intermediate operands are freed as soon as they have been used
+    if (left_owned)
+    {
+        *live_bytes -= matrixBytes(&left);
+        freeMatrix(&left);
+    }
+    if (right_owned)
+    {
+        *live_bytes -= matrixBytes(&right);
+        freeMatrix(&right);
+    }
+    *owned = 1;
+    return product;
+}
+
+CSRMatrix chainProduct(const CSRMatrix *const *matrices, int count, const int *split, double drop_tolerance, ChainStats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    if (count < 1)
+    {
+        fprintf(stderr, "Error: A chain needs at least one matrix.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    int *own_split = NULL; // only used when the caller did not compute the order already
+    if (split == NULL)
+    {
+        own_split = (int *)malloc((size_t)count * count * sizeof(int));
+        if (own_split == NULL)
+        {
+            fprintf(stderr, "Error: Memory allocation failed for the chain order.\n");
+            exit(EXIT_FAILURE);
+        }
+        chainOrder(matrices, count, own_split);
+        split = own_split;
+    }
+
+    ChainWorkspace workspace = {NULL, NULL, 0};
+    size_t live_bytes = 0;
+    int owned;
+    CSRMatrix result = executeInterval(matrices, split, count, 0, count - 1, drop_tolerance, &workspace, stats, &live_bytes, &owned);
+    if (!owned) // a chain of one matrix, return a copy so the caller always owns the result
+    {
+        result = copyMatrix(&result);
+    }
+
+    free(workspace.marker);
+    free(workspace.accumulator);
+    free(own_split);
+    return result;
+}
+
+// The n x n identity matrix, used for A^0
+static CSRMatrix identityMatrix(int n)
+{
+    CSRMatrix I;
+    I.num_rows = n;
+    I.num_cols = n;
+    I.num_non_zeros = n;
+    I.row_ptr = (int *)malloc((n + 1) * sizeof(int));
+    I.col_ind = (int *)malloc((n > 0 ? n : 1) * sizeof(int));
+    I.csr_data = (double *)malloc((n > 0 ? n : 1) * sizeof(double));
+    if (I.row_ptr == NULL || I.col_ind == NULL || I.csr_data == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for the identity matrix.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < n; i++)
+    {
+        I.row_ptr[i] = i;
+        I.col_ind[i] = i;
+        I.csr_data[i] = 1.0;
+    }
+    I.row_ptr[n] = n;
+    I.sorted = 1;
+    I.owns_data = 1;
+    return I;
+}
+
+CSRMatrix matrixPower(const CSRMatrix *A, int k, double drop_tolerance, ChainStats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    if (A->num_rows != A->num_cols || k < 0)
+    {
+        fprintf(stderr, "Error: Matrix powers need a square matrix and a non-negative exponent.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (k == 0)
+    {
+        return identityMatrix(A->num_rows);
+    }
+
+    /* Repeated squaring: walk through the bits of k, squaring the base at every bit and multiplying it into the result when
+    the bit is set. A^k then takes about 2 log2(k) products instead of k - 1. */
+    ChainWorkspace workspace = {NULL, NULL, 0};
+    size_t live_bytes = 0;
+    CSRMatrix base = *A; // A^(2^bit), starts as A itself which belongs to the caller
+    int base_owned = 0;
+    CSRMatrix result;
+    int have_result = 0;
+
+    while (k > 0)
+    {
+        if (k & 1)
+        {
+            if (!have_result)
+            {
+                result = copyMatrix(&base);
+                live_bytes += matrixBytes(&result);
+                have_result = 1;
+            }
+            else
+            {
+                CSRMatrix product = multiplyReusing(&result, &base, drop_tolerance, &workspace);
+                recordProduct(stats, &product, productFlops(&result, &base), &live_bytes);
+                live_bytes -= matrixBytes(&result);
+                freeMatrix(&result);
+                result = product;
+            }
+        }
+        k >>= 1;
+        if (k > 0) // only square again when a higher bit is still needed
+        {
+            CSRMatrix square = multiplyReusing(&base, &base, drop_tolerance, &workspace);
+            recordProduct(stats, &square, productFlops(&base, &base), &live_bytes);
+            if (base_owned)
+            {
+                live_bytes -= matrixBytes(&base);
+                freeMatrix(&base);
+            }
+            base = square;
+            base_owned = 1;
+        }
+    }
+
+    if (base_owned)
+    {
+        freeMatrix(&base);
+    }
+    free(workspace.marker);
+    free(workspace.accumulator);
+    return result;
+}
@@ -0,0 +1,21 @@
+#ifndef CHAIN_H
+#define CHAIN_H
+
+#include <stddef.h>    // provides size_t
+#include "functions.h" // needed for the CSRMatrix struct
+
+// Statistics about the intermediate results of a chain product or matrix power
+typedef struct {
+    int multiplications;          // number of sparse products that were computed
+    long long total_flops;        // multiply-adds of all those products
+    long long peak_non_zeros;     // largest number of non-zeros of a single intermediate (or final) product
+    size_t peak_bytes;            // largest CSR memory held by intermediate products at the same time
+} ChainStats;
+
+double chainOrder(const CSRMatrix *const *matrices, int count, int *split); // fills the count x count split table of the cheapest order and returns its estimated cost
+void describeChainOrder(const int *split, int count, char *buffer, size_t size); // writes the chosen order as a parenthesised expression like ((M1*M2)*M3)
+CSRMatrix chainProduct(const CSRMatrix *const *matrices, int count, const int *split, double drop_tolerance,
+                       ChainStats *stats); // M1 * M2 * ... * Mcount in the order of the split table from chainOrder(), NULL computes it; entries with |value| <= drop_tolerance are dropped
+CSRMatrix matrixPower(const CSRMatrix *A, int k, double drop_tolerance, ChainStats *stats); // A^k by repeated squaring (k = 0 gives the identity), dropping like chainProduct()
+
+#endif
@@ -0,0 +1,267 @@
+#include <stdio.h>       // the standard c library
+#include "compressed.h"  // reference the header file with the compressed matrix declarations
+#include <stdlib.h>      // provides memory allocation functions
+#include <string.h>      // provides memcpy()
+
+// Number of bytes the varint encoding of value takes
+static int varintLength(unsigned int value)
+{
+    int length = 1;
+    while (value >= 128) // every extra byte holds 7 more bits
+    {
+        value >>= 7;
+        length++;
+    }
+    return length;
+}
+
+// Writes value as a varint: 7 bits per byte starting with the lowest bits, the high bit is set on every byte except the last
+static unsigned char *writeVarint(unsigned char *out, unsigned int value)
+{
+    while (value >= 128)
+    {
+        *out++ = (unsigned char)((value & 127) | 128);
+        value >>= 7;
+    }
+    *out++ = (unsigned char)value;
+    return out;
+}
+
+// Reads one varint into *value and returns the position of the next one. Single byte values are by far the most common so they are checked first
+static inline const unsigned char *readVarint(const unsigned char *in, unsigned int *value)
+{
+    unsigned int result = *in++;
+    if (result < 128)
+    {
+        *value = result;
+        return in;
+    }
+
+    result &= 127;
+    int shift = 7;
+    unsigned int byte;
+    do
+    {
+        byte = *in++;
+        result |= (byte & 127) << shift;
+        shift += 7;
+    } while (byte & 128);
+    *value = result;
+    return in;
+}
+
+CompressedCSRMatrix compressCSR(const CSRMatrix *A, int num_threads)
+{
+    // deltas between consecutive columns are only non-negative when the rows are sorted, so unsorted input is sorted on a copy first
+    CSRMatrix sorted_copy;
+    const CSRMatrix *source = A;
+    if (!A->sorted)
+    {
+        sorted_copy = copyMatrix(A);
+        sortRows(&sorted_copy, num_threads);
+        source = &sorted_copy;
+    }
+
+    if (num_threads < 1)
+    {
+        num_threads = 1;
+    }
+
+    CompressedCSRMatrix C;
+    C.num_rows = source->num_rows;
+    C.num_cols = source->num_cols;
+    C.num_non_zeros = source->num_non_zeros;
+    C.row_offset = (size_t *)malloc((C.num_rows + 1) * sizeof(size_t));
+    C.row_ptr = (int *)malloc((C.num_rows + 1) * sizeof(int));
+    C.csr_data = (double *)malloc((C.num_non_zeros > 0 ? C.num_non_zeros : 1) * sizeof(double));
+    if (C.row_offset == NULL || C.row_ptr == NULL || C.csr_data == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for the compressed matrix.\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(C.row_ptr, source->row_ptr, (C.num_rows + 1) * sizeof(int));
+    memcpy(C.csr_data, source->csr_data, C.num_non_zeros * sizeof(double));
+
+    // first pass: the encoded length of every row, computed in parallel because the rows are independent
+    C.row_offset[0] = 0;
+#pragma omp parallel for schedule(dynamic, 256) num_threads(num_threads)
+    for (int i = 0; i < C.num_rows; i++)
+    {
+        size_t length = 0;
+        int previous = 0; // the first column of a row is stored as a delta from column 0
+        for (int j = source->row_ptr[i]; j < source->row_ptr[i + 1]; j++)
+        {
+            length += varintLength((unsigned int)(source->col_ind[j] - previous));
+            previous = source->col_ind[j];
+        }
+        C.row_offset[i + 1] = length;
+    }
+    for (int i = 0; i < C.num_rows; i++) // prefix sum turns the lengths into start offsets
+    {
+        C.row_offset[i + 1] += C.row_offset[i];
+    }
+    C.num_bytes = C.row_offset[C.num_rows];
+
+    C.col_bytes = (unsigned char *)malloc(C.num_bytes > 0 ? C.num_bytes : 1);
+    if (C.col_bytes == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for col_bytes.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // second pass: every row is encoded into its own part of col_bytes
+#pragma omp parallel for schedule(dynamic, 256) num_threads(num_threads)
+    for (int i = 0; i < C.num_rows; i++)
+    {
+        unsigned char *out = C.col_bytes + C.row_offset[i];
+        int previous = 0;
+        for (int j = source->row_ptr[i]; j < source->row_ptr[i + 1]; j++)
+        {
+            out = writeVarint(out, (unsigned int)(source->col_ind[j] - previous));
+            previous = source->col_ind[j];
+        }
+    }
+
+    if (source != A)
+    {
+        freeMatrix(&sorted_copy);
+    }
+    return C;
+}
+
+CSRMatrix decompressCSR(const CompressedCSRMatrix *A)
+{
+    CSRMatrix C;
+    C.num_rows = A->num_rows;
+    C.num_cols = A->num_cols;
+    C.num_non_zeros = A->num_non_zeros;
+    C.row_ptr = (int *)malloc((C.num_rows + 1) * sizeof(int));
+    C.col_ind = (int *)malloc((C.num_non_zeros > 0 ? C.num_non_zeros : 1) * sizeof(int));
+    C.csr_data = (double *)malloc((C.num_non_zeros > 0 ? C.num_non_zeros : 1) * sizeof(double));
+    if (C.row_ptr == NULL || C.col_ind == NULL || C.csr_data == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed while decompressing a matrix.\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(C.row_ptr, A->row_ptr, (C.num_rows + 1) * sizeof(int));
+    memcpy(C.csr_data, A->csr_data, C.num_non_zeros * sizeof(double));
+
+    for (int i = 0; i < A->num_rows; i++)
+    {
+        const unsigned char *in = A->col_bytes + A->row_offset[i];
+        int col = 0;
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++)
+        {
+            unsigned int delta;
+            in = readVarint(in, &delta);
+            col += (int)delta; // undo the delta encoding
+            C.col_ind[j] = col;
+        }
+    }
+    C.sorted = 1; // compressCSR() only ever encodes sorted rows
+    C.owns_data = 1;
+    return C;
+}
+
+void spmvCompressed(const CompressedCSRMatrix *A, const double *x, double *y, int num_threads)
+{
+    if (num_threads < 1)
+    {
+        num_threads = 1;
+    }
+
+    // same as spmv() except that the column of every entry is decoded from the byte stream of its row
+#pragma omp parallel for schedule(static) num_threads(num_threads)
+    for (int i = 0; i < A->num_rows; i++)
+    {
+        const unsigned char *in = A->col_bytes + A->row_offset[i];
+        int col = 0;
+        double sum = 0.0;
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++)
+        {
+            unsigned int delta;
+            in = readVarint(in, &delta);
+            col += (int)delta;
+            sum += A->csr_data[j] * x[col];
+        }
+        y[i] = sum;
+    }
+}
+
+CSRMatrix transposeCompressed(const CompressedCSRMatrix *A)
+{
+    CSRMatrix A_transpose;
+    A_transpose.num_rows = A->num_cols;
+    A_transpose.num_cols = A->num_rows;
+    A_transpose.num_non_zeros = A->num_non_zeros;
+    A_transpose.row_ptr = (int *)calloc(A_transpose.num_rows + 1, sizeof(int));
+    A_transpose.col_ind = (int *)malloc((A->num_non_zeros > 0 ? A->num_non_zeros : 1) * sizeof(int));
+    A_transpose.csr_data = (double *)malloc((A->num_non_zeros > 0 ? A->num_non_zeros : 1) * sizeof(double));
+    if (A_transpose.row_ptr == NULL || A_transpose.col_ind == NULL || A_transpose.csr_data == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for the transpose.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // count the entries of every column of A (= rows of A^T), this is the same counting step as in transpose()
+    for (int i = 0; i < A->num_rows; i++)
+    {
+        const unsigned char *in = A->col_bytes + A->row_offset[i];
+        int col = 0;
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++)
+        {
+            unsigned int delta;
+            in = readVarint(in, &delta);
+            col += (int)delta;
+            A_transpose.row_ptr[col + 1]++;
+        }
+    }
+    for (int i = 1; i <= A_transpose.num_rows; i++)
+    {
+        A_transpose.row_ptr[i] += A_transpose.row_ptr[i - 1];
+    }
+
+    // place every entry at the next free position of its column, the rows of A are visited in order so the rows of A^T come out sorted
+    int *next_position = (int *)malloc((A_transpose.num_rows > 0 ? A_transpose.num_rows : 1) * sizeof(int));
+    if (next_position == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for next_position.\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(next_position, A_transpose.row_ptr, A_transpose.num_rows * sizeof(int));
+    for (int i = 0; i < A->num_rows; i++)
+    {
+        const unsigned char *in = A->col_bytes + A->row_offset[i];
+        int col = 0;
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++)
+        {
+            unsigned int delta;
+            in = readVarint(in, &delta);
+            col += (int)delta;
+            int dest = next_position[col]++;
+            A_transpose.col_ind[dest] = i;
+            A_transpose.csr_data[dest] = A->csr_data[j];
+        }
+    }
+    free(next_position);
+
+    A_transpose.sorted = 1;
+    A_transpose.owns_data = 1;
+    return A_transpose;
+}
+
+void freeCompressedMatrix(CompressedCSRMatrix *A)
+{
+    free(A->csr_data);
+    free(A->col_bytes);
+    free(A->row_offset);
+    free(A->row_ptr);
+    A->csr_data = NULL;
+    A->col_bytes = NULL;
+    A->row_offset = NULL;
+    A->row_ptr = NULL;
+    A->num_bytes = 0;
+    A->num_non_zeros = 0;
+    A->num_rows = 0;
+    A->num_cols = 0;
+}
@@ -0,0 +1,28 @@
+#ifndef COMPRESSED_H
+#define COMPRESSED_H
+
+#include <stddef.h>    // provides size_t
+#include "functions.h" // needed for the CSRMatrix struct
+
+/* CSR matrix with compressed column indices. The column indices of every row are stored as the first column followed by the
+differences between consecutive columns, each written as a varint (7 bits per byte, the high bit says another byte follows).
+Rows of sparse matrices tend to have nearby columns, so most differences fit in a single byte instead of the 4 bytes of an int,
+which cuts the memory traffic of bandwidth bound kernels such as SpMV. */
+typedef struct {
+    double *csr_data;         // Array of non-zero values, in the same order as in the CSR matrix
+    unsigned char *col_bytes; // Varint encoded column deltas of all rows one after the other
+    size_t *row_offset;       // Row i's encoded columns start at col_bytes[row_offset[i]] (num_rows + 1 entries)
+    int *row_ptr;             // Array of row pointers into csr_data, same as in the CSR matrix
+    size_t num_bytes;         // Length of col_bytes
+    int num_non_zeros;        // Number of non-zero elements
+    int num_rows;             // Number of rows in matrix
+    int num_cols;             // Number of columns in matrix
+} CompressedCSRMatrix;
+
+CompressedCSRMatrix compressCSR(const CSRMatrix *A, int num_threads); // encodes A (a sorted copy is used when the rows of A are not sorted)
+CSRMatrix decompressCSR(const CompressedCSRMatrix *A);                // decodes back into a plain CSR matrix with sorted rows
+void spmvCompressed(const CompressedCSRMatrix *A, const double *x, double *y, int num_threads); // y = A * x, decoding the columns on the fly
+CSRMatrix transposeCompressed(const CompressedCSRMatrix *A);          // A^T as a plain CSR matrix, decoding the columns on the fly
+void freeCompressedMatrix(CompressedCSRMatrix *A);                    // frees the memory of a compressed matrix
+
+#endif
@@ -0,0 +1,477 @@
+#include <stdio.h>       // the standard c library
+#include "distributed.h" // reference the header file with the distributed multiplication declarations
+#include "estimate.h"    // rowFlops() balances the row blocks
+#include "esc.h"         // workers can multiply with expand-sort-compress as well
+#include <stdlib.h>      // provides memory allocation functions
+#include <string.h>      // provides memcpy() and memset()
+#include <fcntl.h>       // provides the O_* flags of shm_open()
+#include <unistd.h>      // provides fork(), execl(), ftruncate() and close()
+#include <sys/mman.h>    // provides shm_open(), shm_unlink() and mmap()
+#include <sys/stat.h>    // provides fstat() to find the size of a segment
+#include <sys/wait.h>    // provides wait() and waitpid() for the worker processes
+
+#define SEGMENT_NAME_LENGTH 64 // "/csr-calculator-<pid>-<worker>-out" always fits
+#define WORKER_PROGRAM "/proc/self/exe" // the launcher starts the workers from the same executable as the coordinator
+
+// Start of an input segment, followed by A data, B data, A row_ptr, A col_ind, B row_ptr and B col_ind
+typedef struct {
+    int num_rows;          // rows of the block of A
+    int num_rows_B;        // rows of B that were sent, the columns of the block of A are renumbered to them
+    int num_cols_B;        // columns of B, which are the columns of C
+    int nnz_A;             // entries of the block of A
+    int nnz_B;             // entries of the rows of B that were sent
+    int sorted_B;          // the rows of B are sorted
+    int use_esc;           // 1 to multiply with expand-sort-compress instead of the column marker kernel
+    double drop_tolerance; // entries of C with |value| <= drop_tolerance are dropped
+} WorkerInput;
+
+// Start of an output segment, followed by C data, C row_ptr and C col_ind
+typedef struct {
+    int num_rows;          // rows of the block of C
+    int num_cols;          // columns of C
+    int num_non_zeros;     // entries of the block of C
+    int sorted;            // the rows of the block are sorted
+    double compute_time;   // wall time of the kernel inside the worker
+} WorkerOutput;
+
+// Doubles come right after the header, so 8 byte alignment of the header keeps every array aligned
+static size_t inputBytes(const WorkerInput *in)
+{
+    return sizeof(WorkerInput) + ((size_t)in->nnz_A + in->nnz_B) * sizeof(double) +
+           ((size_t)in->num_rows + 1 + in->nnz_A + (size_t)in->num_rows_B + 1 + in->nnz_B) * sizeof(int);
+}
+
+static size_t outputBytes(const WorkerOutput *out)
+{
+    return sizeof(WorkerOutput) + (size_t)out->num_non_zeros * sizeof(double) + ((size_t)out->num_rows + 1 + out->num_non_zeros) * sizeof(int);
+}
+
+/* Creates (or opens) a shared memory segment of the given size and maps it, when opening *size is set to the size it already
+has. Returns NULL after reporting the error, so the coordinator can clean up its other segments and workers before it stops. */
+static void *mapSegment(const char *name, int create, size_t *size)
+{
+    int descriptor = create ? shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600) : shm_open(name, O_RDWR, 0600);
+    if (descriptor < 0)
+    {
+        fprintf(stderr, "Error: Failed to open the shared memory segment %s\n", name);
+        return NULL;
+    }
+    struct stat info;
+    if ((create && ftruncate(descriptor, (off_t)*size) != 0) || (!create && fstat(descriptor, &info) != 0))
+    {
+        fprintf(stderr, "Error: Failed to size the shared memory segment %s\n", name);
+        close(descriptor);
+        return NULL;
+    }
+    if (!create)
+    {
+        *size = (size_t)info.st_size;
+    }
+    void *segment = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+    close(descriptor); // the mapping keeps the segment alive
+    if (segment == MAP_FAILED)
+    {
+        fprintf(stderr, "Error: Failed to map the shared memory segment %s\n", name);
+        return NULL;
+    }
+    return segment;
+}
+
+// Name of the output segment that belongs to an input segment
+static void outputName(const char *input_name, char *name)
+{
+    snprintf(name, SEGMENT_NAME_LENGTH, "%s-out", input_name);
+}
+
+void runWorker(const char *segment_name)
+{
+    size_t size = 0;
+    char *segment = (char *)mapSegment(segment_name, 0, &size);
+    if (segment == NULL)
+    {
+        exit(EXIT_FAILURE);
+    }
+    WorkerInput in;
+    memcpy(&in, segment, sizeof(in));
+    if (size < sizeof(WorkerInput) || size != inputBytes(&in))
+    {
+        fprintf(stderr, "Error: The shared memory segment %s is not a worker input.\n", segment_name);
+        exit(EXIT_FAILURE);
+    }
+
+    // the block of A and the rows of B are used straight from the segment, these views are never passed to freeMatrix()
+    CSRMatrix A, B;
+    char *position = segment + sizeof(WorkerInput);
+    A.csr_data = (double *)position;
+    position += (size_t)in.nnz_A * sizeof(double);
+    B.csr_data = (double *)position;
+    position += (size_t)in.nnz_B * sizeof(double);
+    A.row_ptr = (int *)position;
+    position += ((size_t)in.num_rows + 1) * sizeof(int);
+    A.col_ind = (int *)position;
+    position += (size_t)in.nnz_A * sizeof(int);
+    B.row_ptr = (int *)position;
+    position += ((size_t)in.num_rows_B + 1) * sizeof(int);
+    B.col_ind = (int *)position;
+    A.num_rows = in.num_rows;
+    A.num_cols = in.num_rows_B;
+    A.num_non_zeros = in.nnz_A;
+    A.sorted = 0; // renumbering the columns does not keep them in order
+    A.owns_data = 0;
+    B.num_rows = in.num_rows_B;
+    B.num_cols = in.num_cols_B;
+    B.num_non_zeros = in.nnz_B;
+    B.sorted = in.sorted_B;
+    B.owns_data = 0;
+
+    double start_time = wallTime();
+    CSRMatrix C = in.use_esc ? multiplicationESC(&A, &B, in.drop_tolerance, 1) : multiplicationWithTolerance(&A, &B, in.drop_tolerance);
+    WorkerOutput out = {C.num_rows, C.num_cols, C.num_non_zeros, C.sorted, wallTime() - start_time};
+    munmap(segment, size);
+
+    char name[SEGMENT_NAME_LENGTH];
+    outputName(segment_name, name);
+    size = outputBytes(&out);
+    segment = (char *)mapSegment(name, 1, &size);
+    if (segment == NULL)
+    {
+        exit(EXIT_FAILURE);
+    }
+    position = segment;
+    memcpy(position, &out, sizeof(out));
+    position += sizeof(out);
+    memcpy(position, C.csr_data, (size_t)C.num_non_zeros * sizeof(double));
+    position += (size_t)C.num_non_zeros * sizeof(double);
+    memcpy(position, C.row_ptr, ((size_t)C.num_rows + 1) * sizeof(int));
+    position += ((size_t)C.num_rows + 1) * sizeof(int);
+    memcpy(position, C.col_ind, (size_t)C.num_non_zeros * sizeof(int));
+    munmap(segment, size);
+    freeMatrix(&C);
+}
+
+// Local launcher: starts a worker process that only knows the name of its input segment, returns -1 when it can not
+static pid_t launchWorker(const char *segment_name)
+{
+    char argument[SEGMENT_NAME_LENGTH + 16];
+    snprintf(argument, sizeof(argument), "--worker=%s", segment_name);
+    fflush(stdout); // nothing buffered may be written twice if the exec fails
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        fprintf(stderr, "Error: Failed to start a worker process.\n");
+        return -1;
+    }
+    if (pid == 0)
+    {
+        execl(WORKER_PROGRAM, "main", argument, (char *)NULL);
+        fprintf(stderr, "Error: Failed to run %s for a worker process.\n", WORKER_PROGRAM);
+        _exit(EXIT_FAILURE);
+    }
+    return pid;
+}
+
+// Removes the input and output segments of every worker, segments that were never created are skipped silently
+static void unlinkSegments(char (*names)[SEGMENT_NAME_LENGTH], int num_workers)
+{
+    for (int w = 0; w < num_workers; w++)
+    {
+        char name[SEGMENT_NAME_LENGTH];
+        outputName(names[w], name);
+        shm_unlink(names[w]);
+        shm_unlink(name);
+    }
+}
+
+/* Stops the coordinator after a failure while the workers were being started: waits for the num_launched workers that are
+already running, so none of them is left behind, then removes the segments of the first num_created workers. */
+static void abortWorkers(char (*names)[SEGMENT_NAME_LENGTH], const pid_t *pids, int num_launched, int num_created)
+{
+    for (int w = 0; w < num_launched; w++)
+    {
+        waitpid(pids[w], NULL, 0);
+    }
+    unlinkSegments(names, num_created);
+    fprintf(stderr, "Error: The worker processes could not be started, the product was not computed.\n");
+    exit(EXIT_FAILURE);
+}
+
+CSRMatrix multiplicationDistributed(const CSRMatrix *A, const CSRMatrix *B, double drop_tolerance, int num_workers, int use_esc,
+                                    int num_threads, DistributedReport *report)
+{
+    if (A->num_cols != B->num_rows)
+    {
+        fprintf(stderr, "Error: Incompatible dimensions, please try again.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (num_workers > A->num_rows)
+    {
+        num_workers = A->num_rows; // every worker gets at least one row
+    }
+    if (num_workers < 1)
+    {
+        num_workers = 1;
+    }
+    if (num_threads < 1)
+    {
+        num_threads = 1;
+    }
+    report->num_workers = num_workers;
+    report->workers = (WorkerReport *)calloc(num_workers, sizeof(WorkerReport));
+    char (*names)[SEGMENT_NAME_LENGTH] = malloc(num_workers * sizeof(*names));
+    pid_t *pids = (pid_t *)malloc(num_workers * sizeof(pid_t));
+    double *launch_times = (double *)malloc(num_workers * sizeof(double));
+    int *b_local = (int *)malloc((B->num_rows > 0 ? B->num_rows : 1) * sizeof(int));    // local number of a row of B in the current block, -1 if not sent
+    int *b_rows = (int *)malloc((B->num_rows > 0 ? B->num_rows : 1) * sizeof(int));     // rows of B sent with the current block, in local order
+    if (report->workers == NULL || names == NULL || pids == NULL || launch_times == NULL || b_local == NULL || b_rows == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for the worker processes.\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(b_local, -1, (size_t)B->num_rows * sizeof(int));
+
+    // cut A into blocks with about the same number of multiply-adds, equal row counts would leave the workers with dense rows behind
+    double start_time = wallTime();
+    long long *flops = rowFlops(A, B);
+    long long total_flops = 0;
+    for (int i = 0; i < A->num_rows; i++)
+    {
+        total_flops += flops[i];
+    }
+    int row = 0;
+    long long done_flops = 0;
+    for (int w = 0; w < num_workers; w++)
+    {
+        WorkerReport *worker = &report->workers[w];
+        worker->first_row = row;
+        if (w == num_workers - 1)
+        {
+            row = A->num_rows;
+        }
+        else
+        {
+            long long target = total_flops * (w + 1) / num_workers;
+            int limit = A->num_rows - (num_workers - w - 1); // leaves at least one row for every later worker
+            do
+            {
+                done_flops += flops[row++];
+            } while (row < limit && done_flops + flops[row] <= target);
+        }
+        worker->last_row = row;
+    }
+    free(flops);
+
+    /* Fill the input segment of every worker and launch it straight away, so the first workers already compute while the later
+    blocks are packed. The columns of the block of A are renumbered to the rows of B that are sent. */
+    double run_start = wallTime();
+    report->pack_time = run_start - start_time;
+    for (int w = 0; w < num_workers; w++)
+    {
+        double pack_start = wallTime();
+        WorkerReport *worker = &report->workers[w];
+        int first = worker->first_row, last = worker->last_row;
+        WorkerInput in;
+        in.num_rows = last - first;
+        in.num_rows_B = 0;
+        in.num_cols_B = B->num_cols;
+        in.nnz_A = A->row_ptr[last] - A->row_ptr[first];
+        in.sorted_B = B->sorted;
+        in.use_esc = use_esc;
+        in.drop_tolerance = drop_tolerance;
+        long long nnz_B = 0;
+        for (int j = A->row_ptr[first]; j < A->row_ptr[last]; j++)
+        {
+            int col = A->col_ind[j];
+            if (b_local[col] < 0)
+            {
+                b_local[col] = in.num_rows_B;
+                b_rows[in.num_rows_B++] = col;
+                nnz_B += B->row_ptr[col + 1] - B->row_ptr[col];
+            }
+        }
+        in.nnz_B = (int)nnz_B; // at most nnz(B)
+
+        snprintf(names[w], SEGMENT_NAME_LENGTH, "/csr-calculator-%ld-%d", (long)getpid(), w);
+        size_t size = inputBytes(&in);
+        char *segment = (char *)mapSegment(names[w], 1, &size);
+        if (segment == NULL)
+        {
+            abortWorkers(names, pids, w, w + 1); // the segment of worker w may exist without being mapped
+        }
+        char *position = segment;
+        memcpy(position, &in, sizeof(in));
+        position += sizeof(in);
+        double *a_data = (double *)position;
+        position += (size_t)in.nnz_A * sizeof(double);
+        double *b_data = (double *)position;
+        position += (size_t)in.nnz_B * sizeof(double);
+        int *a_row_ptr = (int *)position;
+        position += ((size_t)in.num_rows + 1) * sizeof(int);
+        int *a_col_ind = (int *)position;
+        position += (size_t)in.nnz_A * sizeof(int);
+        int *b_row_ptr = (int *)position;
+        position += ((size_t)in.num_rows_B + 1) * sizeof(int);
+        int *b_col_ind = (int *)position;
+
+        int base = A->row_ptr[first];
+        memcpy(a_data, A->csr_data + base, (size_t)in.nnz_A * sizeof(double));
+        for (int i = 0; i <= in.num_rows; i++)
+        {
+            a_row_ptr[i] = A->row_ptr[first + i] - base;
+        }
+        for (int j = 0; j < in.nnz_A; j++)
+        {
+            a_col_ind[j] = b_local[A->col_ind[base + j]];
+        }
+        b_row_ptr[0] = 0;
+        for (int k = 0; k < in.num_rows_B; k++)
+        {
+            int source = b_rows[k];
+            int length = B->row_ptr[source + 1] - B->row_ptr[source];
+            memcpy(b_data + b_row_ptr[k], B->csr_data + B->row_ptr[source], (size_t)length * sizeof(double));
+            memcpy(b_col_ind + b_row_ptr[k], B->col_ind + B->row_ptr[source], (size_t)length * sizeof(int));
+            b_row_ptr[k + 1] = b_row_ptr[k] + length;
+            b_local[source] = -1; // reset for the next block, only the touched entries
+        }
+        munmap(segment, size);
+
+        worker->nnz_A = in.nnz_A;
+        worker->rows_B = in.num_rows_B;
+        worker->nnz_B = in.nnz_B;
+        worker->bytes_sent = (long long)size;
+        launch_times[w] = wallTime();
+        report->pack_time += launch_times[w] - pack_start; // packing overlaps with the workers that are already running, so it is also part of run_time
+        pids[w] = launchWorker(names[w]);
+        if (pids[w] < 0)
+        {
+            abortWorkers(names, pids, w, w + 1);
+        }
+    }
+    free(b_local);
+    free(b_rows);
+
+    // wait for the workers in the order they finish, so every elapsed time is its own
+    int failed = 0;
+    for (int finished = 0; finished < num_workers; finished++)
+    {
+        int status;
+        pid_t pid = wait(&status);
+        double now = wallTime();
+        for (int w = 0; w < num_workers; w++)
+        {
+            if (pids[w] == pid)
+            {
+                report->workers[w].elapsed_time = now - launch_times[w];
+            }
+        }
+        if (pid < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            failed = 1;
+        }
+    }
+    report->run_time = wallTime() - run_start;
+    if (failed)
+    {
+        unlinkSegments(names, num_workers);
+        fprintf(stderr, "Error: A worker process failed, the product was not computed.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // stitch: the blocks of C come back in row order, so every block is copied to the position after the previous ones
+    start_time = wallTime();
+    char **segments = (char **)malloc(num_workers * sizeof(char *));
+    size_t *sizes = (size_t *)malloc(num_workers * sizeof(size_t));
+    long long *block_start = (long long *)malloc((num_workers + 1) * sizeof(long long));
+    if (segments == NULL || sizes == NULL || block_start == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for the worker results.\n");
+        exit(EXIT_FAILURE);
+    }
+    int sorted = 1;
+    block_start[0] = 0;
+    for (int w = 0; w < num_workers; w++)
+    {
+        char name[SEGMENT_NAME_LENGTH];
+        outputName(names[w], name);
+        sizes[w] = 0;
+        segments[w] = (char *)mapSegment(name, 0, &sizes[w]);
+        if (segments[w] == NULL)
+        {
+            unlinkSegments(names, num_workers); // every worker has exited already
+            exit(EXIT_FAILURE);
+        }
+        WorkerOutput out;
+        memcpy(&out, segments[w], sizeof(out));
+        if (sizes[w] < sizeof(WorkerOutput) || sizes[w] != outputBytes(&out) ||
+            out.num_rows != report->workers[w].last_row - report->workers[w].first_row)
+        {
+            unlinkSegments(names, num_workers);
+            fprintf(stderr, "Error: Worker %d returned a damaged result.\n", w);
+            exit(EXIT_FAILURE);
+        }
+        report->workers[w].bytes_returned = (long long)sizes[w];
+        report->workers[w].compute_time = out.compute_time;
+        sorted = sorted && out.sorted;
+        block_start[w + 1] = block_start[w] + out.num_non_zeros;
+    }
+    unlinkSegments(names, num_workers); // the names go away now, the mappings stay valid until munmap()
+    if (block_start[num_workers] > 2147483647LL)
+    {
+        fprintf(stderr, "Error: The product has more non-zeros than a CSR matrix can hold.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    CSRMatrix C;
+    C.num_rows = A->num_rows;
+    C.num_cols = B->num_cols;
+    C.num_non_zeros = (int)block_start[num_workers];
+    C.row_ptr = (int *)malloc((C.num_rows + 1) * sizeof(int));
+    C.col_ind = (int *)malloc((C.num_non_zeros > 0 ? C.num_non_zeros : 1) * sizeof(int));
+    C.csr_data = (double *)malloc((C.num_non_zeros > 0 ? C.num_non_zeros : 1) * sizeof(double));
+    if (C.row_ptr == NULL || C.col_ind == NULL || C.csr_data == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for the product.\n");
+        exit(EXIT_FAILURE);
+    }
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+    for (int w = 0; w < num_workers; w++)
+    {
+        WorkerOutput out;
+        memcpy(&out, segments[w], sizeof(out));
+        const char *position = segments[w] + sizeof(WorkerOutput);
+        const double *data = (const double *)position;
+        position += (size_t)out.num_non_zeros * sizeof(double);
+        const int *row_ptr = (const int *)position;
+        position += ((size_t)out.num_rows + 1) * sizeof(int);
+        const int *col_ind = (const int *)position;
+
+        int offset = (int)block_start[w];
+        int first = report->workers[w].first_row;
+        for (int i = 0; i < out.num_rows; i++)
+        {
+            C.row_ptr[first + i] = offset + row_ptr[i];
+        }
+        memcpy(C.col_ind + offset, col_ind, (size_t)out.num_non_zeros * sizeof(int));
+        memcpy(C.csr_data + offset, data, (size_t)out.num_non_zeros * sizeof(double));
+        munmap(segments[w], sizes[w]);
+    }
+    C.row_ptr[C.num_rows] = C.num_non_zeros;
+    C.sorted = sorted;
+    C.owns_data = 1;
+    report->stitch_time = wallTime() - start_time;
+
+    free(segments);
+    free(sizes);
+    free(block_start);
+    free(names);
+    free(pids);
+    free(launch_times);
+    return C;
+}
+
+void freeDistributedReport(DistributedReport *report)
+{
+    free(report->workers);
+    report->workers = NULL;
+    report->num_workers = 0;
+}
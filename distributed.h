@@ -0,0 +1,38 @@
+#ifndef DISTRIBUTED_H
+#define DISTRIBUTED_H
+
+#include "functions.h" // needed for the CSRMatrix struct
+
+/* Multiplication split over worker processes with a 1D row partition. The coordinator cuts A into blocks of rows with about
+the same number of multiply-adds and sends every worker its block of A together with only the rows of B that the block refers
+to. Each worker multiplies with the existing kernel and sends its rows of C back, the coordinator stitches them together. All
+data goes through POSIX shared memory segments, and a worker only gets the name of its segment, so the local launcher (a fork
+and exec of this program with --worker=<segment>) is the only part that assumes the workers run on the same machine. */
+
+// What one worker was sent, returned and how long it took
+typedef struct {
+    int first_row;              // first row of A and C in the block
+    int last_row;               // one past the last row of the block
+    int nnz_A;                  // entries of A sent
+    int rows_B;                 // rows of B sent, the distinct columns of the block of A
+    int nnz_B;                  // entries of B sent
+    long long bytes_sent;       // size of the input segment
+    long long bytes_returned;   // size of the output segment
+    double compute_time;        // wall time of the kernel, measured inside the worker
+    double elapsed_time;        // wall time from the launch of the worker until it exited
+} WorkerReport;
+
+typedef struct {
+    int num_workers;            // number of worker processes that were started
+    WorkerReport *workers;      // one report per worker
+    double pack_time;           // wall time spent partitioning and filling the input segments
+    double run_time;            // wall time from the first launch until the last worker exited
+    double stitch_time;         // wall time spent reading the output segments into C
+} DistributedReport;
+
+CSRMatrix multiplicationDistributed(const CSRMatrix *A, const CSRMatrix *B, double drop_tolerance, int num_workers, int use_esc,
+                                    int num_threads, DistributedReport *report); // C = A * B computed by num_workers worker processes, stitched on num_threads threads
+void runWorker(const char *segment_name); // body of a worker process: reads its input segment, multiplies and writes its output segment
+void freeDistributedReport(DistributedReport *report); // frees the per-worker reports
+
+#endif
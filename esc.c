@@ -0,0 +1,267 @@
+#include <stdio.h>     // the standard c library
+#include "esc.h"       // reference the header file with the expand-sort-compress declarations
+#include "estimate.h"  // rowFlops() gives the number of products of every row
+#include <stdlib.h>    // provides memory allocation functions
+#include <string.h>    // provides memcpy() and memset()
+#include <math.h>      // provides fabs()
+
+#define BLOCK_PRODUCTS (1 << 13) // products expanded and sorted together: keys, values and sort buffers take 256 KB, so every radix pass stays in cache
+#define RADIX_BITS 8             // bits sorted per counting pass
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+// Rows first_row .. last_row - 1 of C, computed by one thread
+typedef struct {
+    int first_row;        // first row of A in the block
+    int last_row;         // one past the last row of A in the block
+    long long products;   // number of products the block expands to
+    int num_non_zeros;    // entries of C in the block after compressing
+    int *row_counts;      // entries of every row of the block
+    int *col_ind;         // column indices of the block, row by row
+    double *csr_data;     // values of the block, row by row
+} ESCBlock;
+
+// Number of bits needed to store values 0 .. count - 1 (at least 1)
+static int bitsFor(long long count)
+{
+    int bits = 1;
+    while (bits < 62 && (1LL << bits) < count)
+    {
+        bits++;
+    }
+    return bits;
+}
+
+/* LSD radix sort of (key, value) pairs on the lowest key_bits bits. Each pass is a stable counting sort on 8 bits that moves
+the pairs between the two buffers, the pointers are swapped so *keys and *values always hold the latest order. Passes whose
+digit is the same for every key are skipped. */
+static void radixSortPairs(unsigned long long **keys, double **values, unsigned long long **scratch_keys, double **scratch_values,
+                           long long n, int key_bits)
+{
+    long long count[RADIX_BUCKETS];
+    for (int shift = 0; shift < key_bits; shift += RADIX_BITS)
+    {
+        unsigned long long *in_keys = *keys, *out_keys = *scratch_keys;
+        double *in_values = *values, *out_values = *scratch_values;
+
+        memset(count, 0, sizeof(count));
+        for (long long p = 0; p < n; p++)
+        {
+            count[(in_keys[p] >> shift) & (RADIX_BUCKETS - 1)]++;
+        }
+        if (n > 0 && count[(in_keys[0] >> shift) & (RADIX_BUCKETS - 1)] == n) // already in order on this digit
+        {
+            continue;
+        }
+
+        long long position = 0;
+        for (int d = 0; d < RADIX_BUCKETS; d++)
+        {
+            long long bucket = count[d];
+            count[d] = position;
+            position += bucket;
+        }
+        for (long long p = 0; p < n; p++)
+        {
+            long long target = count[(in_keys[p] >> shift) & (RADIX_BUCKETS - 1)]++;
+            out_keys[target] = in_keys[p];
+            out_values[target] = in_values[p];
+        }
+
+        *keys = out_keys;
+        *values = out_values;
+        *scratch_keys = in_keys;
+        *scratch_values = in_values;
+    }
+}
+
+// Expands, sorts and compresses one block. The four buffers hold at least block->products entries
+static void computeBlock(const CSRMatrix *A, const CSRMatrix *B, ESCBlock *block, int col_bits, double drop_tolerance,
+                         unsigned long long *keys, double *values, unsigned long long *scratch_keys, double *scratch_values)
+{
+    // expand: the key is the row inside the block in the high bits and the column in the low bits, so sorting groups rows and columns at once
+    long long n = 0;
+    for (int i = block->first_row; i < block->last_row; i++)
+    {
+        unsigned long long row_key = (unsigned long long)(i - block->first_row) << col_bits;
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++)
+        {
+            int a_col = A->col_ind[j];
+            double a_val = A->csr_data[j];
+            for (int k = B->row_ptr[a_col]; k < B->row_ptr[a_col + 1]; k++)
+            {
+                keys[n] = row_key | (unsigned long long)B->col_ind[k];
+                values[n++] = a_val * B->csr_data[k];
+            }
+        }
+    }
+
+    // sort
+    int key_bits = col_bits + bitsFor(block->last_row - block->first_row);
+    radixSortPairs(&keys, &values, &scratch_keys, &scratch_values, n, key_bits);
+
+    // compress: add up runs of equal keys in place, then copy the kept entries out of the shared buffers
+    int block_rows = block->last_row - block->first_row;
+    block->row_counts = (int *)calloc(block_rows > 0 ? block_rows : 1, sizeof(int));
+    long long write = 0;
+    for (long long p = 0; p < n;)
+    {
+        unsigned long long key = keys[p];
+        double sum = 0.0;
+        while (p < n && keys[p] == key)
+        {
+            sum += values[p++];
+        }
+        if (fabs(sum) > drop_tolerance) // same rule as pruneRow() in functions.c
+        {
+            keys[write] = key;
+            values[write++] = sum;
+        }
+    }
+
+    block->num_non_zeros = (int)write;
+    block->col_ind = (int *)malloc((write > 0 ? write : 1) * sizeof(int));
+    block->csr_data = (double *)malloc((write > 0 ? write : 1) * sizeof(double));
+    if (block->row_counts == NULL || block->col_ind == NULL || block->csr_data == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for an ESC block.\n");
+        exit(EXIT_FAILURE);
+    }
+    unsigned long long col_mask = (1ULL << col_bits) - 1;
+    for (long long p = 0; p < write; p++)
+    {
+        block->row_counts[keys[p] >> col_bits]++;
+        block->col_ind[p] = (int)(keys[p] & col_mask);
+        block->csr_data[p] = values[p];
+    }
+}
+
+CSRMatrix multiplicationESC(const CSRMatrix *A, const CSRMatrix *B, double drop_tolerance, int num_threads)
+{
+    if (A->num_cols != B->num_rows)
+    {
+        fprintf(stderr, "Error: Incompatible dimensions, please try again.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (num_threads < 1)
+    {
+        num_threads = 1;
+    }
+
+    // cut the rows of A into blocks of about BLOCK_PRODUCTS products, a single row with more products gets a block of its own
+    long long *flops = rowFlops(A, B);
+    int num_blocks = 0, capacity = 16;
+    ESCBlock *blocks = (ESCBlock *)malloc(capacity * sizeof(ESCBlock));
+    if (blocks == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for the ESC blocks.\n");
+        exit(EXIT_FAILURE);
+    }
+    long long largest_block = 1;
+    for (int i = 0; i < A->num_rows;)
+    {
+        if (num_blocks == capacity)
+        {
+            capacity *= 2;
+            blocks = (ESCBlock *)realloc(blocks, capacity * sizeof(ESCBlock));
+            if (blocks == NULL)
+            {
+                fprintf(stderr, "Error: Memory allocation failed for the ESC blocks.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        ESCBlock *block = &blocks[num_blocks++];
+        block->first_row = i;
+        block->products = flops[i++];
+        while (i < A->num_rows && block->products + flops[i] <= BLOCK_PRODUCTS)
+        {
+            block->products += flops[i++];
+        }
+        block->last_row = i;
+        if (block->products > largest_block)
+        {
+            largest_block = block->products;
+        }
+    }
+    free(flops);
+
+    int col_bits = bitsFor(B->num_cols);
+
+#pragma omp parallel num_threads(num_threads)
+    {
+        // every thread sorts in its own buffers, sized for the largest block so they are allocated only once
+        unsigned long long *keys = (unsigned long long *)malloc(largest_block * sizeof(unsigned long long));
+        unsigned long long *scratch_keys = (unsigned long long *)malloc(largest_block * sizeof(unsigned long long));
+        double *values = (double *)malloc(largest_block * sizeof(double));
+        double *scratch_values = (double *)malloc(largest_block * sizeof(double));
+        if (keys == NULL || scratch_keys == NULL || values == NULL || scratch_values == NULL)
+        {
+            fprintf(stderr, "Error: Memory allocation failed for the ESC buffers.\n");
+            exit(EXIT_FAILURE);
+        }
+
+#pragma omp for schedule(dynamic, 1)
+        for (int b = 0; b < num_blocks; b++)
+        {
+            computeBlock(A, B, &blocks[b], col_bits, drop_tolerance, keys, values, scratch_keys, scratch_values);
+        }
+
+        free(keys);
+        free(scratch_keys);
+        free(values);
+        free(scratch_values);
+    }
+
+    // stitch the blocks together: prefix sums give every block its place in C, then the blocks are copied in parallel
+    CSRMatrix C;
+    C.num_rows = A->num_rows;
+    C.num_cols = B->num_cols;
+    C.row_ptr = (int *)malloc((C.num_rows + 1) * sizeof(int));
+    long long *block_start = (long long *)malloc((num_blocks + 1) * sizeof(long long));
+    if (C.row_ptr == NULL || block_start == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for the product.\n");
+        exit(EXIT_FAILURE);
+    }
+    block_start[0] = 0;
+    for (int b = 0; b < num_blocks; b++)
+    {
+        block_start[b + 1] = block_start[b] + blocks[b].num_non_zeros;
+    }
+    if (block_start[num_blocks] > 2147483647LL)
+    {
+        fprintf(stderr, "Error: The product has more non-zeros than a CSR matrix can hold.\n");
+        exit(EXIT_FAILURE);
+    }
+    C.num_non_zeros = (int)block_start[num_blocks];
+    C.col_ind = (int *)malloc((C.num_non_zeros > 0 ? C.num_non_zeros : 1) * sizeof(int));
+    C.csr_data = (double *)malloc((C.num_non_zeros > 0 ? C.num_non_zeros : 1) * sizeof(double));
+    if (C.col_ind == NULL || C.csr_data == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for the product.\n");
+        exit(EXIT_FAILURE);
+    }
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+    for (int b = 0; b < num_blocks; b++)
+    {
+        ESCBlock *block = &blocks[b];
+        int position = (int)block_start[b];
+        for (int i = block->first_row; i < block->last_row; i++)
+        {
+            C.row_ptr[i] = position;
+            position += block->row_counts[i - block->first_row];
+        }
+        memcpy(C.col_ind + block_start[b], block->col_ind, block->num_non_zeros * sizeof(int));
+        memcpy(C.csr_data + block_start[b], block->csr_data, block->num_non_zeros * sizeof(double));
+        free(block->row_counts);
+        free(block->col_ind);
+        free(block->csr_data);
+    }
+    C.row_ptr[C.num_rows] = C.num_non_zeros;
+    C.sorted = 1; // the keys were sorted by column inside every row
+    C.owns_data = 1;
+
+    free(block_start);
+    free(blocks);
+    return C;
+}
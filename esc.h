@@ -0,0 +1,11 @@
+#ifndef ESC_H
+#define ESC_H
+
+#include "functions.h" // needed for the CSRMatrix struct
+
+/* Expand-sort-compress SpGEMM: every product A(i, k) * B(k, j) is written out with the key (i, j), the keys are radix sorted
+and equal keys are added up. It does not need a marker array as wide as B, and the result always has sorted rows. The rows of
+A are processed in blocks with a bounded number of products, and the blocks are shared out between num_threads threads. */
+CSRMatrix multiplicationESC(const CSRMatrix *A, const CSRMatrix *B, double drop_tolerance, int num_threads); // C = A * B, drops |value| <= drop_tolerance
+
+#endif
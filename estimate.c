@@ -0,0 +1,234 @@
+#include <stdio.h>     // the standard c library
+#include "estimate.h"  // reference the header file with the estimator declarations
+#include <stdlib.h>    // provides memory allocation functions
+#include <string.h>    // provides memset()
+#include <math.h>      // provides sqrt()
+
+#define DEFAULT_SAMPLED_ROWS 1000 // rows of A looked at when the caller does not choose a sample size
+#define CONFIDENCE_Z 1.96         // normal quantile for a 95% confidence interval
+
+long long *rowFlops(const CSRMatrix *A, const CSRMatrix *B)
+{
+    long long *flops = (long long *)malloc((A->num_rows > 0 ? A->num_rows : 1) * sizeof(long long));
+    if (flops == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for the row flops.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // every entry A(i, k) is multiplied with every entry of row k of B, so row i needs the sum of the lengths of those rows of B
+    for (int i = 0; i < A->num_rows; i++)
+    {
+        long long count = 0;
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++)
+        {
+            count += B->row_ptr[A->col_ind[j] + 1] - B->row_ptr[A->col_ind[j]];
+        }
+        flops[i] = count;
+    }
+    return flops;
+}
+
+long long productFlops(const CSRMatrix *A, const CSRMatrix *B)
+{
+    long long total = 0;
+    for (int j = 0; j < A->num_non_zeros; j++) // same sum as rowFlops() without storing the per row counts
+    {
+        total += B->row_ptr[A->col_ind[j] + 1] - B->row_ptr[A->col_ind[j]];
+    }
+    return total;
+}
+
+RowStatistics rowStatistics(const CSRMatrix *A)
+{
+    RowStatistics statistics = {0, 0, 0.0, 0};
+    for (int i = 0; i < A->num_rows; i++)
+    {
+        int length = A->row_ptr[i + 1] - A->row_ptr[i];
+        if (i == 0 || length < statistics.min_row)
+        {
+            statistics.min_row = length;
+        }
+        if (length > statistics.max_row)
+        {
+            statistics.max_row = length;
+        }
+        if (length == 0)
+        {
+            statistics.empty_rows++;
+        }
+    }
+    statistics.mean_row = A->num_rows > 0 ? (double)A->num_non_zeros / A->num_rows : 0.0;
+    return statistics;
+}
+
+int *columnCounts(const CSRMatrix *A)
+{
+    int *counts = (int *)calloc(A->num_cols > 0 ? A->num_cols : 1, sizeof(int));
+    if (counts == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for the column counts.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int j = 0; j < A->num_non_zeros; j++)
+    {
+        counts[A->col_ind[j]]++;
+    }
+    return counts;
+}
+
+long long flopsFromColumnCounts(const int *column_counts, int num_columns, const CSRMatrix *B)
+{
+    if (num_columns != B->num_rows)
+    {
+        fprintf(stderr, "Error: Incompatible dimensions, please try again.\n");
+        exit(EXIT_FAILURE);
+    }
+    // every entry in column k of A meets all of row k of B, so the sum of productFlops() can be grouped by k
+    long long total = 0;
+    for (int k = 0; k < num_columns; k++)
+    {
+        total += (long long)column_counts[k] * (B->row_ptr[k + 1] - B->row_ptr[k]);
+    }
+    return total;
+}
+
+// Small xorshift random number generator, good enough to pick sample rows and reproducible for a given seed
+static unsigned int nextRandom(unsigned int *state)
+{
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+// CSR memory of a num_rows matrix with the given number of non-zeros
+static size_t csrBytes(double non_zeros, int num_rows)
+{
+    return (size_t)(non_zeros * (sizeof(double) + sizeof(int))) + (size_t)(num_rows + 1) * sizeof(int);
+}
+
+ProductEstimate estimateProduct(const CSRMatrix *A, const CSRMatrix *B, int num_sampled_rows, unsigned int seed)
+{
+    if (A->num_cols != B->num_rows)
+    {
+        fprintf(stderr, "Error: Incompatible dimensions, please try again.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    ProductEstimate result;
+    long long *flops = rowFlops(A, B);
+
+    // exact flop count, and the upper bound: row i of C can not have more entries than its flops or than the number of columns
+    result.flops = 0;
+    result.upper_bound = 0;
+    for (int i = 0; i < A->num_rows; i++)
+    {
+        result.flops += flops[i];
+        result.upper_bound += flops[i] < B->num_cols ? flops[i] : B->num_cols;
+    }
+
+    /* Rows of A without any multiply-add give empty rows of C, so they are known exactly and only the other rows are sampled.
+    On skewed matrices most rows can be empty products, and a sample drawn from all rows could then miss every row that matters. */
+    int *rows = (int *)malloc((A->num_rows > 0 ? A->num_rows : 1) * sizeof(int));
+    int *marker = (int *)malloc((B->num_cols > 0 ? B->num_cols : 1) * sizeof(int));
+    if (rows == NULL || marker == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for the estimator.\n");
+        exit(EXIT_FAILURE);
+    }
+    int N = 0; // number of rows with at least one multiply-add, the population that is sampled
+    for (int i = 0; i < A->num_rows; i++)
+    {
+        if (flops[i] > 0)
+        {
+            rows[N++] = i;
+        }
+    }
+    int n = num_sampled_rows > 0 ? num_sampled_rows : DEFAULT_SAMPLED_ROWS;
+    if (n > N)
+    {
+        n = N;
+    }
+    result.sampled_rows = n;
+
+    /* Pick n different rows at random with a partial Fisher-Yates shuffle and compute the exact number of non-zeros of those
+    rows of C with the same column marker trick the multiplication function uses. The cost is proportional to the flops of the
+    sampled rows only, so for n much smaller than the number of rows it is a small fraction of the multiplication. */
+    memset(marker, -1, (size_t)B->num_cols * sizeof(int));
+
+    unsigned int state = seed != 0 ? seed : 0x9e3779b9u; // xorshift must not start at 0
+    double sum_nnz = 0.0, sum_flops = 0.0;
+    double *sample_nnz = (double *)malloc((n > 0 ? n : 1) * sizeof(double));
+    if (sample_nnz == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for the estimator.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int k = 0; k < n; k++)
+    {
+        int pick = k + (int)(nextRandom(&state) % (unsigned int)(N - k)); // swap a random not yet sampled row into place k
+        int temp = rows[k];
+        rows[k] = rows[pick];
+        rows[pick] = temp;
+
+        int i = rows[k];
+        int count = 0;
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++)
+        {
+            int a_col = A->col_ind[j];
+            for (int l = B->row_ptr[a_col]; l < B->row_ptr[a_col + 1]; l++)
+            {
+                if (marker[B->col_ind[l]] != k) // marker[col] == k means the column was already counted for this sample
+                {
+                    marker[B->col_ind[l]] = k;
+                    count++;
+                }
+            }
+        }
+        sample_nnz[k] = count;
+        sum_nnz += count;
+        sum_flops += flops[i];
+    }
+
+    /* Ratio estimator: nnz(C) is estimated as flops(C) times the nnz/flops ratio of the sample. Rows with many flops usually also
+    have many non-zeros, so this is much more accurate than scaling up the average row. The 95% interval comes from the variance
+    of the residuals nnz_k - ratio * flops_k, with the finite population correction (1 - n / N) so a full sample gives an exact answer. */
+    double ratio = sum_flops > 0 ? sum_nnz / sum_flops : 0.0;
+    result.estimate = ratio * result.flops;
+    if (sum_flops == 0 && result.flops > 0) // the sample says nothing about the ratio: average row, and an interval up to the bound
+    {
+        result.estimate = n > 0 ? sum_nnz / n * N : 0.0;
+        result.confidence_interval = result.upper_bound - result.estimate;
+    }
+    else if (n >= N || n < 2)
+    {
+        result.confidence_interval = n >= N ? 0.0 : result.upper_bound - result.estimate;
+    }
+    else
+    {
+        double sum_squares = 0.0;
+        for (int k = 0; k < n; k++)
+        {
+            double residual = sample_nnz[k] - ratio * flops[rows[k]];
+            sum_squares += residual * residual;
+        }
+        double variance = (double)N * N * (1.0 - (double)n / N) * (sum_squares / (n - 1)) / n;
+        result.confidence_interval = CONFIDENCE_Z * sqrt(variance);
+    }
+    if (result.estimate > result.upper_bound) // the sample can never justify more than the guaranteed bound
+    {
+        result.estimate = (double)result.upper_bound;
+    }
+
+    result.bytes_upper_bound = csrBytes((double)result.upper_bound, A->num_rows);
+    result.bytes_estimate = csrBytes(result.estimate, A->num_rows);
+
+    free(flops);
+    free(rows);
+    free(marker);
+    free(sample_nnz);
+    return result;
+}
@@ -0,0 +1,33 @@
+#ifndef ESTIMATE_H
+#define ESTIMATE_H
+
+#include <stddef.h>    // provides size_t
+#include "functions.h" // needed for the CSRMatrix struct
+
+// What is known about the product C = A * B before computing it
+typedef struct {
+    long long flops;              // exact number of multiply-adds the product needs (FLOPs = 2 * flops)
+    long long upper_bound;        // guaranteed upper bound on nnz(C)
+    double estimate;              // estimate of nnz(C) from a sample of the rows of A
+    double confidence_interval;   // half width of the 95% confidence interval around estimate
+    int sampled_rows;             // number of rows of A in the sample
+    size_t bytes_upper_bound;     // memory C needs in CSR form when it has upper_bound non-zeros
+    size_t bytes_estimate;        // memory C needs in CSR form when it has estimate non-zeros
+} ProductEstimate;
+
+// Row length statistics of a single matrix, cheap to get and useful before deciding how to compute with it
+typedef struct {
+    int min_row;          // shortest row
+    int max_row;          // longest row
+    double mean_row;      // average row length
+    int empty_rows;       // rows without any entry
+} RowStatistics;
+
+long long *rowFlops(const CSRMatrix *A, const CSRMatrix *B); // multiply-adds needed for every row of A * B (num_rows entries)
+long long productFlops(const CSRMatrix *A, const CSRMatrix *B); // exact multiply-adds of A * B
+RowStatistics rowStatistics(const CSRMatrix *A); // shortest, longest and average row and number of empty rows
+int *columnCounts(const CSRMatrix *A); // non-zeros in every column of A (num_cols entries), only needs A
+long long flopsFromColumnCounts(const int *column_counts, int num_columns, const CSRMatrix *B); // multiply-adds of A * B from the column counts of A
+ProductEstimate estimateProduct(const CSRMatrix *A, const CSRMatrix *B, int num_sampled_rows, unsigned int seed); // flops, upper bound and sampled estimate of nnz(A * B)
+
+#endif
@@ -2,11 +2,19 @@
 #include "functions.h" // reference the header file with function declarations
 #include <stdlib.h>    // provides memory allocation functions
 #include <string.h>    // provides string based functions
+#include <math.h>      // provides fabs() for the drop tolerance
+#include <time.h>      // provides clock_gettime() for wallTime()
 
 // NOTE: The code for the addition and subtraction function is identitical to the only two minor sign changes are needed and are reflected by comments saying "CHANGE FROM ADDITION:"
 //       The comments are also for the most part the same as the addition function
 
 void ReadMMtoCSR(const char *filename, CSRMatrix *matrix)
+{
+    LoadOptions options = {0, 0}; // keep the entries exactly as they are in the file
+    ReadMMtoCSRWithOptions(filename, matrix, &options);
+}
+
+void ReadMMtoCSRWithOptions(const char *filename, CSRMatrix *matrix, const LoadOptions *options)
 {
 
     FILE *file = fopen(filename, "r"); // open the provided filename in read mode
@@ -120,9 +128,118 @@ void ReadMMtoCSR(const char *filename, CSRMatrix *matrix)
 
     free(temporary_row_ptr); // we need to make sure to free up temporary memory for the temporary array we initialized as it is no longer needed
     fclose(file);            // make sure to close the file when done
+
+    coalesceEntries(matrix, options->sum_duplicates, options->drop_zeros); // sum duplicates and/or drop explicit zeros once here so no kernel has to deal with them later
+
+    matrix->sorted = rowsAreSorted(matrix); // the entries keep the order of the file, so record whether that order happens to be sorted
+    matrix->owns_data = 1;
+}
+
+/* Removes the entries of the row that starts at row_start and ends at *row_end whose absolute value is at most drop_tolerance.
+The kept entries are shifted to the left (so their order is unchanged) and *row_end is moved back to the new end of the row.
+The kernels call this as soon as a row of C is complete, which replaces a separate pass over the whole result. */
+static void pruneRow(CSRMatrix *C, int row_start, int *row_end, double drop_tolerance)
+{
+    int write = row_start; // next position a kept entry is moved to
+    for (int j = row_start; j < *row_end; j++)
+    {
+        if (fabs(C->csr_data[j]) > drop_tolerance)
+        {
+            C->csr_data[write] = C->csr_data[j];
+            C->col_ind[write] = C->col_ind[j];
+            write++;
+        }
+    }
+    *row_end = write;
+}
+
+// Shrinks the values and column indices arrays (which were allocated for the worst case) down to exactly num_non_zeros entries
+static void shrinkToFit(CSRMatrix *C)
+{
+    size_t size = C->num_non_zeros > 0 ? (size_t)C->num_non_zeros : 1; // realloc to 0 bytes may return NULL so always keep at least one entry
+    double *csr_data = (double *)realloc(C->csr_data, size * sizeof(double));
+    int *col_ind = (int *)realloc(C->col_ind, size * sizeof(int));
+    // shrinking can not really fail, but if it does the old (larger) arrays are still valid so we simply keep them
+    if (csr_data != NULL)
+    {
+        C->csr_data = csr_data;
+    }
+    if (col_ind != NULL)
+    {
+        C->col_ind = col_ind;
+    }
+}
+
+void coalesceEntries(CSRMatrix *matrix, int sum_duplicates, int drop_zeros)
+{
+    if (!sum_duplicates && !drop_zeros)
+    {
+        return; // nothing to do
+    }
+
+    int *column_marker = NULL; // position in the compacted arrays where each column of the current row was first stored, -1 if not seen yet
+    if (sum_duplicates)
+    {
+        column_marker = (int *)malloc((matrix->num_cols > 0 ? matrix->num_cols : 1) * sizeof(int));
+        if (column_marker == NULL)
+        {
+            fprintf(stderr, "Error: Memory allocation failed for column_marker.\n");
+            exit(EXIT_FAILURE);
+        }
+        memset(column_marker, -1, matrix->num_cols * sizeof(int)); // -1 is not a valid position, same trick as in the addition function
+    }
+
+    /* The arrays are compacted in place: "write" never overtakes the entry being read, so no second copy of the matrix is needed.
+    With the column markers every entry is looked at once, so the whole pass is O(nnz) and keeps the original order of the
+    entries (a sorted matrix stays sorted). */
+    int write = 0;
+    for (int i = 0; i < matrix->num_rows; i++)
+    {
+        int row_start = write;
+        int read_end = matrix->row_ptr[i + 1]; // read the old end before row_ptr[i + 1] is overwritten by the next row
+        for (int j = matrix->row_ptr[i]; j < read_end; j++)
+        {
+            int col_index = matrix->col_ind[j];
+            if (sum_duplicates && column_marker[col_index] != -1) // repeated (row, column): add it to the entry that was kept
+            {
+                matrix->csr_data[column_marker[col_index]] += matrix->csr_data[j];
+                continue;
+            }
+            if (sum_duplicates)
+            {
+                column_marker[col_index] = write;
+            }
+            matrix->col_ind[write] = col_index;
+            matrix->csr_data[write] = matrix->csr_data[j];
+            write++;
+        }
+        matrix->row_ptr[i] = row_start;
+
+        if (sum_duplicates) // reset the markers of this row before the positions move, so they can not be confused with positions of the next row
+        {
+            for (int j = row_start; j < write; j++)
+            {
+                column_marker[matrix->col_ind[j]] = -1;
+            }
+        }
+        if (drop_zeros) // zeros are dropped after summing because duplicates may cancel out
+        {
+            pruneRow(matrix, row_start, &write, 0.0);
+        }
+    }
+    matrix->row_ptr[matrix->num_rows] = write;
+    matrix->num_non_zeros = write;
+    shrinkToFit(matrix);
+
+    free(column_marker);
 }
 
 CSRMatrix addition(const CSRMatrix *A, const CSRMatrix *B)
+{
+    return additionWithTolerance(A, B, 0.0); // a tolerance of 0 only drops entries which are exactly zero
+}
+
+CSRMatrix additionWithTolerance(const CSRMatrix *A, const CSRMatrix *B, double drop_tolerance)
 {
     // Check to see if dimensions are comaptible, both matrices must have the same number of rows and columns
     if (A->num_rows != B->num_rows || A->num_cols != B->num_cols)
@@ -183,130 +300,103 @@ CSRMatrix addition(const CSRMatrix *A, const CSRMatrix *B)
 
     int num_non_zeros_C = 0; // initalized the number of non-zero entries for the resultant matrix to be C, this will be the actual variable used at the end opposed to the temporary one
 
-    for (int i = 0; i < C.num_rows; i++) // iterate through the number of rows in the matriced
+    if (A->sorted && B->sorted)
     {
-        C.row_ptr[i] = num_non_zeros_C; // set the row pointer for resultant matirx C to the current num_non_zeros_C value to mark the start of non-zero elements in C.
-
-        // nested loop to process the non-zero elements of matrix A
-        for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++) // iterate through the non-zero elements in the current row of matrix A
+        /* When the rows of both A and B are sorted we can merge the two rows like in merge sort instead of using the column markers.
+        Every row of C then comes out sorted for free, so C can be marked as sorted and no later sort is needed. */
+        for (int i = 0; i < C.num_rows; i++)
         {
-            int col_index = A->col_ind[j];                // retrieves and assigns the column index of the current non-zero element to "col_index"
-            C.csr_data[num_non_zeros_C] = A->csr_data[j]; // copy the non-zero value from A to C
-            C.col_ind[num_non_zeros_C] = col_index;       // sets the column index in C to the column index cooresponding to the current non-zero entry
-            column_marker[col_index] = num_non_zeros_C;   // mark the cooresponding column to reflect that it has been processed by setting it equal to num_non_zeros_C
-            num_non_zeros_C++;                            // increment the non zero counter by 1
+            C.row_ptr[i] = num_non_zeros_C;
+            int a = A->row_ptr[i], a_end = A->row_ptr[i + 1]; // current position and end of the ith row of A
+            int b = B->row_ptr[i], b_end = B->row_ptr[i + 1]; // current position and end of the ith row of B
+            while (a < a_end || b < b_end)
+            {
+                if (b == b_end || (a < a_end && A->col_ind[a] < B->col_ind[b])) // next column only appears in A
+                {
+                    C.col_ind[num_non_zeros_C] = A->col_ind[a];
+                    C.csr_data[num_non_zeros_C++] = A->csr_data[a++];
+                }
+                else if (a == a_end || B->col_ind[b] < A->col_ind[a]) // next column only appears in B
+                {
+                    C.col_ind[num_non_zeros_C] = B->col_ind[b];
+                    C.csr_data[num_non_zeros_C++] = B->csr_data[b++];
+                }
+                else // same column in both rows
+                {
+                    C.col_ind[num_non_zeros_C] = A->col_ind[a];
+                    C.csr_data[num_non_zeros_C++] = A->csr_data[a++] + B->csr_data[b++];
+                }
+            }
+            pruneRow(&C, C.row_ptr[i], &num_non_zeros_C, drop_tolerance); // the row is complete, drop the entries that cancelled out
         }
+        C.sorted = 1;
+    }
+    else
+    {
+        C.sorted = 0; // the marker loop below emits the columns in the order they are first seen
 
-        // nested loop to process the non-zero elements of matrix B
-        for (int j = B->row_ptr[i]; j < B->row_ptr[i + 1]; j++)
+        for (int i = 0; i < C.num_rows; i++) // iterate through the number of rows in the matriced
         {
-            int col_index = B->col_ind[j];      // retrieves and assigns the column index of the current non-zero element to "col_index"
-            if (column_marker[col_index] != -1) // checks whether the column has already been process by matrix A through referencing its column marker
-            {
-                C.csr_data[column_marker[col_index]] += B->csr_data[j];
-                // if the column has already been marked/processed then it adds the cooreponding value in matrix B from the already assigned value in matrix C
-                // this is effectively performing addition on cooresponding entries
-            }
-            else // if the column has not been processed/marked the following block is entered
+            C.row_ptr[i] = num_non_zeros_C; // set the row pointer for resultant matirx C to the current num_non_zeros_C value to mark the start of non-zero elements in C.
+
+            // nested loop to process the non-zero elements of matrix A
+            for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++) // iterate through the non-zero elements in the current row of matrix A
             {
-                C.csr_data[num_non_zeros_C] = B->csr_data[j]; // assigns the value of the cooresponding entry in matrix B to matrix C (same as doing adding the entry in B to 0)
+                int col_index = A->col_ind[j];                // retrieves and assigns the column index of the current non-zero element to "col_index"
+                C.csr_data[num_non_zeros_C] = A->csr_data[j]; // copy the non-zero value from A to C
                 C.col_ind[num_non_zeros_C] = col_index;       // sets the column index in C to the column index cooresponding to the current non-zero entry
                 column_marker[col_index] = num_non_zeros_C;   // mark the cooresponding column to reflect that it has been processed by setting it equal to num_non_zeros_C
                 num_non_zeros_C++;                            // increment the non zero counter by 1
             }
-        }
-
-        /* Now something very important that needs to be done is the column markers for each column need to be reset to -1.
-        The reason for this is that when the computation is performed for the next row they need to be reset as the same columns
-        may need to accessed or not and we need to know whether the columns have been processed or not for each cooresponding row
-        iteration.*/
-
-        // reset column markers for matrix A
-        for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++) // loops from the starting index of non-zero elements to the ending index of non-zero elements
-        {
-            int col_index = A->col_ind[j]; // retrieves the column index of the current non-zero element
-            column_marker[col_index] = -1; // resets the column marker for the cooresponding column_index back to -1
-        }
-
-        // reset column markers for matrix B
-        for (int j = B->row_ptr[i]; j < B->row_ptr[i + 1]; j++) // loops from the starting index of non-zero elements to the ending index of non-zero elements
-        {
-            int col_index = B->col_ind[j]; // retrieves the column index of the current non-zero element
-            column_marker[col_index] = -1; // resets the column marker for the cooresponding column_index back to -1
-        }
-    }
-
-    C.row_ptr[C.num_rows] = num_non_zeros_C; // finalize the row_ptr array by setting its last element to the number of non-zero elements to adhere to CSR format
 
-    /* An issue I was coming across when testing the functions was that my results were printing some 0's in the values array which is incorrect as it is only
-    supposed to include non-zero elements. It also led to there being an extra number of elements in the number of non-zero elements counter. To fix this I decided a solution would be
-    that after completing the computation, revise and update the arrays and variables to remove these 0's and display the correct output */
-
-    // To start I declared and allocated memory for new arrays which will represent the filtered versions of the values, column indices, and row pointer arrays
-    double *filtered_csr_data = (double *)malloc(num_non_zeros_C * sizeof(double));
-    if (filtered_csr_data == NULL) // memory allocation failure check
-    {
-        fprintf(stderr, "Error: Memory allocation failed for filtered_csr_data.\n");
-        free(C.row_ptr);
-        free(C.csr_data);
-        free(C.col_ind);
-        free(column_marker);
-        exit(EXIT_FAILURE);
-    }
-
-    int *filtered_col_ind = (int *)malloc(num_non_zeros_C * sizeof(int));
-    if (filtered_col_ind == NULL) // memory allocation failure check
-    {
-        fprintf(stderr, "Error: Memory allocation failed for filtered_col_ind.\n");
-        free(C.row_ptr);
-        free(C.csr_data);
-        free(C.col_ind);
-        free(column_marker);
-        free(filtered_csr_data);
-        exit(EXIT_FAILURE);
-    }
+            // nested loop to process the non-zero elements of matrix B
+            for (int j = B->row_ptr[i]; j < B->row_ptr[i + 1]; j++)
+            {
+                int col_index = B->col_ind[j];      // retrieves and assigns the column index of the current non-zero element to "col_index"
+                if (column_marker[col_index] != -1) // checks whether the column has already been process by matrix A through referencing its column marker
+                {
+                    C.csr_data[column_marker[col_index]] += B->csr_data[j];
+                    // if the column has already been marked/processed then it adds the cooreponding value in matrix B from the already assigned value in matrix C
+                    // this is effectively performing addition on cooresponding entries
+                }
+                else // if the column has not been processed/marked the following block is entered
+                {
+                    C.csr_data[num_non_zeros_C] = B->csr_data[j]; // assigns the value of the cooresponding entry in matrix B to matrix C (same as doing adding the entry in B to 0)
+                    C.col_ind[num_non_zeros_C] = col_index;       // sets the column index in C to the column index cooresponding to the current non-zero entry
+                    column_marker[col_index] = num_non_zeros_C;   // mark the cooresponding column to reflect that it has been processed by setting it equal to num_non_zeros_C
+                    num_non_zeros_C++;                            // increment the non zero counter by 1
+                }
+            }
 
-    int *filtered_row_ptr = (int *)calloc(C.num_rows + 1, sizeof(int));
-    if (filtered_col_ind == NULL) // memory allocation failure check
-    {
-        fprintf(stderr, "Error: Memory allocation failed for filtered_row_ptr.\n");
-        free(C.row_ptr);
-        free(C.csr_data);
-        free(C.col_ind);
-        free(column_marker);
-        free(filtered_csr_data);
-        free(filtered_col_ind);
-        exit(EXIT_FAILURE);
-    }
+            /* Now something very important that needs to be done is the column markers for each column need to be reset to -1.
+            The reason for this is that when the computation is performed for the next row they need to be reset as the same columns
+            may need to accessed or not and we need to know whether the columns have been processed or not for each cooresponding row
+            iteration.*/
 
-    int filtered_num_non_zeros = 0;      // temporarily set the filtered number of non zero elements to 0
-    for (int i = 0; i < C.num_rows; i++) // iterate over the rows in C
-    {
-        filtered_row_ptr[i] = filtered_num_non_zeros; // set the starting index for the filtered row pointers array, similar logic as earlier in the code
+            // reset column markers for matrix A
+            for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++) // loops from the starting index of non-zero elements to the ending index of non-zero elements
+            {
+                int col_index = A->col_ind[j]; // retrieves the column index of the current non-zero element
+                column_marker[col_index] = -1; // resets the column marker for the cooresponding column_index back to -1
+            }
 
-        for (int j = C.row_ptr[i]; j < C.row_ptr[i + 1]; j++) // iterate over the non-zero elements in the cooresponding row
-        {
-            if (C.csr_data[j] != 0) // check if the value of the current element is not equal to zero
+            // reset column markers for matrix B
+            for (int j = B->row_ptr[i]; j < B->row_ptr[i + 1]; j++) // loops from the starting index of non-zero elements to the ending index of non-zero elements
             {
-                // if it is a nonzero element
-                filtered_csr_data[filtered_num_non_zeros] = C.csr_data[j]; // copy it to the filtered data array at the index cooresponding to the filtered non-zero elements counter
-                filtered_col_ind[filtered_num_non_zeros] = C.col_ind[j];   // copy the cooresponding column index to the filtered colum indices array at the same index
-                filtered_num_non_zeros++;                                  // increment counter after each element
+                int col_index = B->col_ind[j]; // retrieves the column index of the current non-zero element
+                column_marker[col_index] = -1; // resets the column marker for the cooresponding column_index back to -1
             }
+            pruneRow(&C, C.row_ptr[i], &num_non_zeros_C, drop_tolerance); // the row is complete, drop the entries that cancelled out
         }
     }
 
-    filtered_row_ptr[C.num_rows] = filtered_num_non_zeros; // finalize the row pinter array by assigning the last element to the number of non-zero elements
-
-    // Now we need to update the values, row pointer, and column indices arrays to the filtered versions but before that we need to free their previous memory
-    free(C.csr_data);
-    free(C.col_ind);
-    free(C.row_ptr);
+    C.row_ptr[C.num_rows] = num_non_zeros_C; // finalize the row_ptr array by setting its last element to the number of non-zero elements to adhere to CSR format
 
-    C.num_non_zeros = filtered_num_non_zeros; // update number of non zero elements counter
-    C.csr_data = filtered_csr_data;           // update data array
-    C.col_ind = filtered_col_ind;             // update column indices array
-    C.row_ptr = filtered_row_ptr;             // update row pointers array
+    /* The entries that cancelled out (or fell below drop_tolerance) were already pruned row by row while C was being built,
+    so instead of copying C into filtered arrays we only give back the unused part of the temporary arrays */
+    C.num_non_zeros = num_non_zeros_C;
+    C.owns_data = 1;
+    shrinkToFit(&C);
 
     // If everything is allocated successfully we still need to make sure to free up any temporary memory which is no longer needed once all the computation is completed
     free(column_marker);
@@ -315,6 +405,11 @@ CSRMatrix addition(const CSRMatrix *A, const CSRMatrix *B)
 }
 
 CSRMatrix subtraction(const CSRMatrix *A, const CSRMatrix *B)
+{
+    return subtractionWithTolerance(A, B, 0.0); // a tolerance of 0 only drops entries which are exactly zero
+}
+
+CSRMatrix subtractionWithTolerance(const CSRMatrix *A, const CSRMatrix *B, double drop_tolerance)
 {
     // Check to see if dimensions are comaptible, both matrices must have the same number of rows and columns
     if (A->num_rows != B->num_rows || A->num_cols != B->num_cols)
@@ -375,140 +470,254 @@ CSRMatrix subtraction(const CSRMatrix *A, const CSRMatrix *B)
 
     int num_non_zeros_C = 0; // initalized the number of non-zero entries for the resultant matrix to be C, this will be the actual variable used at the end opposed to the temporary one
 
-    for (int i = 0; i < C.num_rows; i++) // iterate through the number of rows in the matriced
+    if (A->sorted && B->sorted)
     {
-        C.row_ptr[i] = num_non_zeros_C; // set the row pointer for resultant matirx C to the current num_non_zeros_C value to mark the start of non-zero elements in C.
-
-        // nested loop to process the non-zero elements of matrix A
-        for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++) // iterate through the non-zero elements in the current row of matrix A
+        /* When the rows of both A and B are sorted we can merge the two rows like in merge sort instead of using the column markers.
+        Every row of C then comes out sorted for free, so C can be marked as sorted and no later sort is needed. */
+        for (int i = 0; i < C.num_rows; i++)
         {
-            int col_index = A->col_ind[j];                // retrieves and assigns the column index of the current non-zero element to "col_index"
-            C.csr_data[num_non_zeros_C] = A->csr_data[j]; // copy the non-zero value from A to C
-            C.col_ind[num_non_zeros_C] = col_index;       // sets the column index in C to the column index cooresponding to the current non-zero entry
-            column_marker[col_index] = num_non_zeros_C;   // mark the cooresponding column to reflect that it has been processed by setting it equal to num_non_zeros_C
-            num_non_zeros_C++;                            // increment the non zero counter by 1
+            C.row_ptr[i] = num_non_zeros_C;
+            int a = A->row_ptr[i], a_end = A->row_ptr[i + 1]; // current position and end of the ith row of A
+            int b = B->row_ptr[i], b_end = B->row_ptr[i + 1]; // current position and end of the ith row of B
+            while (a < a_end || b < b_end)
+            {
+                if (b == b_end || (a < a_end && A->col_ind[a] < B->col_ind[b])) // next column only appears in A
+                {
+                    C.col_ind[num_non_zeros_C] = A->col_ind[a];
+                    C.csr_data[num_non_zeros_C++] = A->csr_data[a++];
+                }
+                else if (a == a_end || B->col_ind[b] < A->col_ind[a]) // next column only appears in B
+                {
+                    C.col_ind[num_non_zeros_C] = B->col_ind[b];
+                    C.csr_data[num_non_zeros_C++] = -B->csr_data[b++]; // CHANGE FROM ADDITION: entries only in B are negated
+                }
+                else // same column in both rows
+                {
+                    C.col_ind[num_non_zeros_C] = A->col_ind[a];
+                    C.csr_data[num_non_zeros_C++] = A->csr_data[a++] - B->csr_data[b++]; // CHANGE FROM ADDITION: subtract instead of add
+                }
+            }
+            pruneRow(&C, C.row_ptr[i], &num_non_zeros_C, drop_tolerance); // the row is complete, drop the entries that cancelled out
         }
+        C.sorted = 1;
+    }
+    else
+    {
+        C.sorted = 0; // the marker loop below emits the columns in the order they are first seen
 
-        // nested loop to process the non-zero elements of matrix B
-        for (int j = B->row_ptr[i]; j < B->row_ptr[i + 1]; j++)
+        for (int i = 0; i < C.num_rows; i++) // iterate through the number of rows in the matriced
         {
-            int col_index = B->col_ind[j];      // retrieves and assigns the column index of the current non-zero element to "col_index"
-            if (column_marker[col_index] != -1) // checks whether the column has already been process by matrix A through referencing its column marker
+            C.row_ptr[i] = num_non_zeros_C; // set the row pointer for resultant matirx C to the current num_non_zeros_C value to mark the start of non-zero elements in C.
+
+            // nested loop to process the non-zero elements of matrix A
+            for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++) // iterate through the non-zero elements in the current row of matrix A
             {
-                // CHANGE FROM ADDITION
-                C.csr_data[column_marker[col_index]] -= B->csr_data[j];
-                // if the column has already been marked/processed then it subtracts the cooreponding value in matrix B from the already assigned value in matrix C
-                // this is effectively performing subtraction on cooresponding entries
+                int col_index = A->col_ind[j];                // retrieves and assigns the column index of the current non-zero element to "col_index"
+                C.csr_data[num_non_zeros_C] = A->csr_data[j]; // copy the non-zero value from A to C
+                C.col_ind[num_non_zeros_C] = col_index;       // sets the column index in C to the column index cooresponding to the current non-zero entry
+                column_marker[col_index] = num_non_zeros_C;   // mark the cooresponding column to reflect that it has been processed by setting it equal to num_non_zeros_C
+                num_non_zeros_C++;                            // increment the non zero counter by 1
             }
-            else // if the column has not been processed/marked the following block is entered
+
+            // nested loop to process the non-zero elements of matrix B
+            for (int j = B->row_ptr[i]; j < B->row_ptr[i + 1]; j++)
             {
-                // CHANGE FROM ADDITION:
-                C.csr_data[num_non_zeros_C] = -(B->csr_data[j]); // assigns the negative value of the cooresponding entry in matrix B to matrix C (same as doing subtractng the entry in B from 0)
-                C.col_ind[num_non_zeros_C] = col_index;          // sets the column index in C to the column index cooresponding to the current non-zero entry
-                column_marker[col_index] = num_non_zeros_C;      // mark the cooresponding column to reflect that it has been processed by setting it equal to num_non_zeros_C
-                num_non_zeros_C++;                               // increment the non zero counter by 1
+                int col_index = B->col_ind[j];      // retrieves and assigns the column index of the current non-zero element to "col_index"
+                if (column_marker[col_index] != -1) // checks whether the column has already been process by matrix A through referencing its column marker
+                {
+                    // CHANGE FROM ADDITION
+                    C.csr_data[column_marker[col_index]] -= B->csr_data[j];
+                    // if the column has already been marked/processed then it subtracts the cooreponding value in matrix B from the already assigned value in matrix C
+                    // this is effectively performing subtraction on cooresponding entries
+                }
+                else // if the column has not been processed/marked the following block is entered
+                {
+                    // CHANGE FROM ADDITION:
+                    C.csr_data[num_non_zeros_C] = -(B->csr_data[j]); // assigns the negative value of the cooresponding entry in matrix B to matrix C (same as doing subtractng the entry in B from 0)
+                    C.col_ind[num_non_zeros_C] = col_index;          // sets the column index in C to the column index cooresponding to the current non-zero entry
+                    column_marker[col_index] = num_non_zeros_C;      // mark the cooresponding column to reflect that it has been processed by setting it equal to num_non_zeros_C
+                    num_non_zeros_C++;                               // increment the non zero counter by 1
+                }
             }
-        }
 
-        /* Now something very important that needs to be done is the column markers for each column need to be reset to -1.
-        The reason for this is that when the computation is performed for the next row they need to be reset as the same columns
-        may need to accessed or not and we need to know whether the columns have been processed or not for each cooresponding row
-        iteration.*/
+            /* Now something very important that needs to be done is the column markers for each column need to be reset to -1.
+            The reason for this is that when the computation is performed for the next row they need to be reset as the same columns
+            may need to accessed or not and we need to know whether the columns have been processed or not for each cooresponding row
+            iteration.*/
 
-        // reset column markers for matrix A
-        for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++) // loops from the starting index of non-zero elements to the ending index of non-zero elements
-        {
-            int col_index = A->col_ind[j]; // retrieves the column index of the current non-zero element
-            column_marker[col_index] = -1; // resets the column marker for the cooresponding column_index back to -1
-        }
+            // reset column markers for matrix A
+            for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++) // loops from the starting index of non-zero elements to the ending index of non-zero elements
+            {
+                int col_index = A->col_ind[j]; // retrieves the column index of the current non-zero element
+                column_marker[col_index] = -1; // resets the column marker for the cooresponding column_index back to -1
+            }
 
-        // reset column markers for matrix B
-        for (int j = B->row_ptr[i]; j < B->row_ptr[i + 1]; j++) // loops from the starting index of non-zero elements to the ending index of non-zero elements
-        {
-            int col_index = B->col_ind[j]; // retrieves the column index of the current non-zero element
-            column_marker[col_index] = -1; // resets the column marker for the cooresponding column_index back to -1
+            // reset column markers for matrix B
+            for (int j = B->row_ptr[i]; j < B->row_ptr[i + 1]; j++) // loops from the starting index of non-zero elements to the ending index of non-zero elements
+            {
+                int col_index = B->col_ind[j]; // retrieves the column index of the current non-zero element
+                column_marker[col_index] = -1; // resets the column marker for the cooresponding column_index back to -1
+            }
+            pruneRow(&C, C.row_ptr[i], &num_non_zeros_C, drop_tolerance); // the row is complete, drop the entries that cancelled out
         }
     }
 
     C.row_ptr[C.num_rows] = num_non_zeros_C; // finalize the row_ptr array by setting its last element to the number of non-zero elements to adhere to CSR format
 
-    /* An issue I was coming across when testing the functions was that my results were printing some 0's in the values array which is incorrect as it is only
-    supposed to include non-zero elements. It also led to there being an extra number of elements in the number of non-zero elements counter. To fix this I decided a solution would be
-    that after completing the computation, revise and update the arrays and variables to remove these 0's and display the correct output */
+    /* The entries that cancelled out (or fell below drop_tolerance) were already pruned row by row while C was being built,
+    so instead of copying C into filtered arrays we only give back the unused part of the temporary arrays */
+    C.num_non_zeros = num_non_zeros_C;
+    C.owns_data = 1;
+    shrinkToFit(&C);
 
-    // To start I declared and allocated memory for new arrays which will represent the filtered versions of the values, column indices, and row pointer arrays
-    double *filtered_csr_data = (double *)malloc(num_non_zeros_C * sizeof(double));
-    if (filtered_csr_data == NULL) // memory allocation failure check
+    // If everything is allocated successfully we still need to make sure to free up any temporary memory which is no longer needed once all the computation is completed
+    free(column_marker);
+
+    return C; // returns the resultant matrix C
+}
+
+CSRMatrix hadamard(const CSRMatrix *A, const CSRMatrix *B)
+{
+    return hadamardWithTolerance(A, B, 0.0); // a tolerance of 0 only drops entries which are exactly zero
+}
+
+CSRMatrix hadamardWithTolerance(const CSRMatrix *A, const CSRMatrix *B, double drop_tolerance)
+{
+    // same dimension check as addition, the element-wise product needs matching rows and columns
+    if (A->num_rows != B->num_rows || A->num_cols != B->num_cols)
     {
-        fprintf(stderr, "Error: Memory allocation failed for filtered_csr_data.\n");
-        free(C.row_ptr);
-        free(C.csr_data);
-        free(C.col_ind);
-        free(column_marker);
+        fprintf(stderr, "Error: Incompatible Dimensions, please try again.\n");
         exit(EXIT_FAILURE);
     }
 
-    int *filtered_col_ind = (int *)malloc(num_non_zeros_C * sizeof(int));
-    if (filtered_col_ind == NULL) // memory allocation failure check
+    CSRMatrix C;
+    C.num_rows = A->num_rows;
+    C.num_cols = A->num_cols;
+    C.row_ptr = (int *)calloc(C.num_rows + 1, sizeof(int));
+
+    /* An entry of C can only be non-zero where both A and B have an entry, so C never has more entries than the sparser of the
+    two. That is the exact worst case, unlike addition where the two counts are added up. */
+    int temp_non_zeros = A->num_non_zeros < B->num_non_zeros ? A->num_non_zeros : B->num_non_zeros;
+    C.csr_data = (double *)malloc((temp_non_zeros > 0 ? temp_non_zeros : 1) * sizeof(double));
+    C.col_ind = (int *)malloc((temp_non_zeros > 0 ? temp_non_zeros : 1) * sizeof(int));
+    if (C.row_ptr == NULL || C.csr_data == NULL || C.col_ind == NULL)
     {
-        fprintf(stderr, "Error: Memory allocation failed for filtered_col_ind.\n");
-        free(C.row_ptr);
-        free(C.csr_data);
-        free(C.col_ind);
-        free(column_marker);
-        free(filtered_csr_data);
+        fprintf(stderr, "Error: Memory allocation failed for the element-wise product.\n");
         exit(EXIT_FAILURE);
     }
 
-    int *filtered_row_ptr = (int *)calloc(C.num_rows + 1, sizeof(int));
-    if (filtered_col_ind == NULL) // memory allocation failure check
+    int num_non_zeros_C = 0;
+    if (A->sorted && B->sorted)
     {
-        fprintf(stderr, "Error: Memory allocation failed for filtered_row_ptr.\n");
-        free(C.row_ptr);
-        free(C.csr_data);
-        free(C.col_ind);
-        free(column_marker);
-        free(filtered_csr_data);
-        free(filtered_col_ind);
-        exit(EXIT_FAILURE);
+        /* Sorted rows are intersected like the merge in addition(), except that columns found in only one row are skipped.
+        Repeated columns are next to each other in a sorted row, so each side is summed over its run of the column first. */
+        for (int i = 0; i < C.num_rows; i++)
+        {
+            C.row_ptr[i] = num_non_zeros_C;
+            int a = A->row_ptr[i], a_end = A->row_ptr[i + 1];
+            int b = B->row_ptr[i], b_end = B->row_ptr[i + 1];
+            while (a < a_end && b < b_end)
+            {
+                int col = A->col_ind[a];
+                if (col < B->col_ind[b])
+                {
+                    a++;
+                }
+                else if (B->col_ind[b] < col)
+                {
+                    b++;
+                }
+                else
+                {
+                    double a_sum = 0.0, b_sum = 0.0;
+                    while (a < a_end && A->col_ind[a] == col)
+                    {
+                        a_sum += A->csr_data[a++];
+                    }
+                    while (b < b_end && B->col_ind[b] == col)
+                    {
+                        b_sum += B->csr_data[b++];
+                    }
+                    C.col_ind[num_non_zeros_C] = col;
+                    C.csr_data[num_non_zeros_C++] = a_sum * b_sum;
+                }
+            }
+            pruneRow(&C, C.row_ptr[i], &num_non_zeros_C, drop_tolerance);
+        }
+        C.sorted = 1;
     }
-
-    int filtered_num_non_zeros = 0;      // temporarily set the filtered number of non zero elements to 0
-    for (int i = 0; i < C.num_rows; i++) // iterate over the rows in C
+    else
     {
-        filtered_row_ptr[i] = filtered_num_non_zeros; // set the starting index for the filtered row pointers array, similar logic as earlier in the code
+        /* Unsorted rows: row i of B is scattered into a dense row (b_row marks which columns it filled), then every entry of
+        row i of A looks its column up there. column_marker plays the same role as in addition(), it keeps repeated columns of A
+        in one entry of C. Since (a1 + a2) * b = a1 * b + a2 * b the products can simply be added up. */
+        int *column_marker = (int *)malloc((C.num_cols > 0 ? C.num_cols : 1) * sizeof(int));
+        int *b_row = (int *)malloc((C.num_cols > 0 ? C.num_cols : 1) * sizeof(int));
+        double *b_values = (double *)malloc((C.num_cols > 0 ? C.num_cols : 1) * sizeof(double));
+        if (column_marker == NULL || b_row == NULL || b_values == NULL)
+        {
+            fprintf(stderr, "Error: Memory allocation failed for the element-wise product.\n");
+            exit(EXIT_FAILURE);
+        }
+        memset(column_marker, -1, C.num_cols * sizeof(int));
+        memset(b_row, -1, C.num_cols * sizeof(int));
 
-        for (int j = C.row_ptr[i]; j < C.row_ptr[i + 1]; j++) // iterate over the non-zero elements in the cooresponding row
+        C.sorted = 0; // the columns of C come out in the order of the columns of A
+        for (int i = 0; i < C.num_rows; i++)
         {
-            if (C.csr_data[j] != 0) // check if the value of the current element is not equal to zero
+            C.row_ptr[i] = num_non_zeros_C;
+            for (int j = B->row_ptr[i]; j < B->row_ptr[i + 1]; j++)
+            {
+                int col_index = B->col_ind[j];
+                if (b_row[col_index] != i)
+                {
+                    b_row[col_index] = i;
+                    b_values[col_index] = 0.0;
+                }
+                b_values[col_index] += B->csr_data[j];
+            }
+            for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++)
+            {
+                int col_index = A->col_ind[j];
+                if (b_row[col_index] != i) // B has nothing in this column, so neither has C
+                {
+                    continue;
+                }
+                if (column_marker[col_index] != -1) // already an entry of this row of C
+                {
+                    C.csr_data[column_marker[col_index]] += A->csr_data[j] * b_values[col_index];
+                }
+                else
+                {
+                    column_marker[col_index] = num_non_zeros_C;
+                    C.col_ind[num_non_zeros_C] = col_index;
+                    C.csr_data[num_non_zeros_C++] = A->csr_data[j] * b_values[col_index];
+                }
+            }
+            for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++) // reset the markers before pruning moves the entries, like addition()
             {
-                // if it is a nonzero element
-                filtered_csr_data[filtered_num_non_zeros] = C.csr_data[j]; // copy it to the filtered data array at the index cooresponding to the filtered non-zero elements counter
-                filtered_col_ind[filtered_num_non_zeros] = C.col_ind[j];   // copy the cooresponding column index to the filtered colum indices array at the same index
-                filtered_num_non_zeros++;                                  // increment counter after each element
+                column_marker[A->col_ind[j]] = -1;
             }
+            pruneRow(&C, C.row_ptr[i], &num_non_zeros_C, drop_tolerance);
         }
+        free(column_marker);
+        free(b_row);
+        free(b_values);
     }
 
-    filtered_row_ptr[C.num_rows] = filtered_num_non_zeros; // finalize the row pinter array by assigning the last element to the number of non-zero elements
-
-    // Now we need to update the values, row pointer, and column indices arrays to the filtered versions but before that we need to free their previous memory
-    free(C.csr_data);
-    free(C.col_ind);
-    free(C.row_ptr);
-
-    C.csr_data = filtered_csr_data;           // update data array
-    C.col_ind = filtered_col_ind;             // update column indices array
-    C.row_ptr = filtered_row_ptr;             // update row pointers array
-    C.num_non_zeros = filtered_num_non_zeros; // update number of non zero elements counter
-
-    // If everything is allocated successfully we still need to make sure to free up any temporary memory which is no longer needed once all the computation is completed
-    free(column_marker);
-
-    return C; // returns the resultant matrix C
+    C.row_ptr[C.num_rows] = num_non_zeros_C;
+    C.num_non_zeros = num_non_zeros_C;
+    C.owns_data = 1;
+    shrinkToFit(&C);
+    return C;
 }
 
 CSRMatrix multiplication(const CSRMatrix *A, const CSRMatrix *B)
+{
+    return multiplicationWithTolerance(A, B, 0.0); // a tolerance of 0 only drops entries which are exactly zero
+}
+
+CSRMatrix multiplicationWithTolerance(const CSRMatrix *A, const CSRMatrix *B, double drop_tolerance)
 {
     // prior to any computation we need to see if the passed matrices have compatible dimensions for multiplication
     // If A is N1xM1 and B is N2xM2 then M1 must equal N2 and the resultant matrix C will have dimensions N1xM2
@@ -607,79 +816,17 @@ CSRMatrix multiplication(const CSRMatrix *A, const CSRMatrix *B)
                 column_marker[b_col_index] = -1; // resets the column marker at the cooresponding index to -1
             }
         }
+        pruneRow(&C, C.row_ptr[i], &num_non_zeros_C, drop_tolerance); // the row is complete, drop the entries that cancelled out (or are below the tolerance)
     }
 
     C.row_ptr[C.num_rows] = num_non_zeros_C; // finalize the row_ptr array by setting its last element to the number of non-zero elements to adhere to CSR format
 
-    /* An issue I was coming across when testing the functions was that my results were printing some 0's in the values array which is incorrect as it is only
-    supposed to include non-zero elements. It also led to there being an extra number of elements in the number of non-zero elements counter. To fix this I decided a solution would be
-    that after completing the computation, revise and update the arrays and variables to remove these 0's and display the correct output */
-
-    // To start I declared and allocated memory for new arrays which will represent the filtered versions of the values, column indices, and row pointer arrays
-    double *filtered_csr_data = (double *)malloc(num_non_zeros_C * sizeof(double));
-    if (filtered_csr_data == NULL) // memory allocation failure check
-    {
-        fprintf(stderr, "Error: Memory allocation failed for filtered_csr_data.\n");
-        free(C.row_ptr);
-        free(C.csr_data);
-        free(C.col_ind);
-        free(column_marker);
-        exit(EXIT_FAILURE);
-    }
-
-    int *filtered_col_ind = (int *)malloc(num_non_zeros_C * sizeof(int));
-    if (filtered_col_ind == NULL) // memory allocation failure check
-    {
-        fprintf(stderr, "Error: Memory allocation failed for filtered_col_ind.\n");
-        free(C.row_ptr);
-        free(C.csr_data);
-        free(C.col_ind);
-        free(column_marker);
-        free(filtered_csr_data);
-        exit(EXIT_FAILURE);
-    }
-
-    int *filtered_row_ptr = (int *)calloc(C.num_rows + 1, sizeof(int));
-    if (filtered_col_ind == NULL) // memory allocation failure check
-    {
-        fprintf(stderr, "Error: Memory allocation failed for filtered_row_ptr.\n");
-        free(C.row_ptr);
-        free(C.csr_data);
-        free(C.col_ind);
-        free(column_marker);
-        free(filtered_csr_data);
-        free(filtered_col_ind);
-        exit(EXIT_FAILURE);
-    }
-
-    int filtered_num_non_zeros = 0;      // temporarily set the filtered number of non zero elements to 0
-    for (int i = 0; i < C.num_rows; i++) // iterate over the rows in C
-    {
-        filtered_row_ptr[i] = filtered_num_non_zeros; // set the starting index for the filtered row pointers array, similar logic as earlier in the code
-
-        for (int j = C.row_ptr[i]; j < C.row_ptr[i + 1]; j++) // iterate over the non-zero elements in the cooresponding row
-        {
-            if (C.csr_data[j] != 0) // check if the value of the current element is not equal to zero
-            {
-                // if it is a nonzero element
-                filtered_csr_data[filtered_num_non_zeros] = C.csr_data[j]; // copy it to the filtered data array at the index cooresponding to the filtered non-zero elements counter
-                filtered_col_ind[filtered_num_non_zeros] = C.col_ind[j];   // copy the cooresponding column index to the filtered colum indices array at the same index
-                filtered_num_non_zeros++;                                  // increment counter after each element
-            }
-        }
-    }
-
-    filtered_row_ptr[C.num_rows] = filtered_num_non_zeros; // finalize the row pinter array by assigning the last element to the number of non-zero elements
-
-    // Now we need to update the values, row pointer, and column indices arrays to the filtered versions but before that we need to free their previous memory
-    free(C.csr_data);
-    free(C.col_ind);
-    free(C.row_ptr);
-
-    C.csr_data = filtered_csr_data;           // update data array
-    C.col_ind = filtered_col_ind;             // update column indices array
-    C.row_ptr = filtered_row_ptr;             // update row pointers array
-    C.num_non_zeros = filtered_num_non_zeros; // update number of non zero elements counter
+    /* The entries that cancelled out (or fell below drop_tolerance) were already pruned row by row while C was being built,
+    so instead of copying C into filtered arrays we only give back the unused part of the temporary arrays */
+    C.num_non_zeros = num_non_zeros_C;
+    C.sorted = 0; // the columns of each row are in the order they were first reached, use sortRows() if sorted rows are needed
+    C.owns_data = 1;
+    shrinkToFit(&C);
 
     // If everything is allocated successfully we still need to make sure to free up any temporary memory which is no longer needed once all the computation is completed
     free(column_marker);
@@ -780,6 +927,9 @@ CSRMatrix transpose(const CSRMatrix *A)
         }
     }
 
+    A_transpose.owns_data = 1;
+    A_transpose.sorted = 1; // the rows of A are visited in increasing order, so every row of A^T is filled in sorted order no matter how A was stored
+
     // Make sure to free up memory by freeing allocated memory for temporary arrays
     free(row_counts);
     free(current_position);
@@ -787,6 +937,26 @@ CSRMatrix transpose(const CSRMatrix *A)
     return A_transpose; // return the transposed matrix A^T
 }
 
+void spmv(const CSRMatrix *A, const double *x, double *y, int num_threads)
+{
+    if (num_threads < 1)
+    {
+        num_threads = 1;
+    }
+
+    // every row of y only depends on one row of A, so the rows can be computed by different threads without any synchronization
+#pragma omp parallel for schedule(static) num_threads(num_threads)
+    for (int i = 0; i < A->num_rows; i++)
+    {
+        double sum = 0.0;
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++)
+        {
+            sum += A->csr_data[j] * x[A->col_ind[j]];
+        }
+        y[i] = sum;
+    }
+}
+
 void printMatrix(const CSRMatrix *matrix)
 {
     printf("Number of non-zeros: %d\n", matrix->num_non_zeros); // print the number of non-zero elements
@@ -814,16 +984,16 @@ void printMatrix(const CSRMatrix *matrix)
 
 void freeMatrix(CSRMatrix *matrix)
 {
-    if (matrix->csr_data != NULL) // Free the allocated memory for csr_data if it isn't empty
+    if (matrix->csr_data != NULL && matrix->owns_data) // Free the allocated memory for csr_data if it isn't empty, a view only lets go of it
     {
         free(matrix->csr_data);
-        matrix->csr_data = NULL;
     }
-    if (matrix->col_ind != NULL) // Free the allocated memory for csr_ind if it isn't empty
+    matrix->csr_data = NULL;
+    if (matrix->col_ind != NULL && matrix->owns_data) // Free the allocated memory for csr_ind if it isn't empty
     {
         free(matrix->col_ind);
-        matrix->col_ind = NULL;
     }
+    matrix->col_ind = NULL;
     if (matrix->row_ptr != NULL) // Free the allocated memory for row_ptr if it isn't empty
     {
         free(matrix->row_ptr);
@@ -834,4 +1004,180 @@ void freeMatrix(CSRMatrix *matrix)
     matrix->num_non_zeros = 0;
     matrix->num_rows = 0;
     matrix->num_cols = 0;
-}
\ No newline at end of file
+    matrix->sorted = 0;
+    matrix->owns_data = 0;
+}
+
+CSRMatrix copyMatrix(const CSRMatrix *A)
+{
+    CSRMatrix C = *A; // copies the dimensions and flags, the arrays are replaced below
+    C.owns_data = 1; // a copy of a view owns its arrays
+    C.row_ptr = (int *)malloc((A->num_rows + 1) * sizeof(int));
+    C.col_ind = (int *)malloc((A->num_non_zeros > 0 ? A->num_non_zeros : 1) * sizeof(int));
+    C.csr_data = (double *)malloc((A->num_non_zeros > 0 ? A->num_non_zeros : 1) * sizeof(double));
+    if (C.row_ptr == NULL || C.col_ind == NULL || C.csr_data == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed while copying a matrix.\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(C.row_ptr, A->row_ptr, (A->num_rows + 1) * sizeof(int));
+    memcpy(C.col_ind, A->col_ind, A->num_non_zeros * sizeof(int));
+    memcpy(C.csr_data, A->csr_data, A->num_non_zeros * sizeof(double));
+    return C;
+}
+
+#define INSERTION_SORT_ROW_LENGTH 16 // rows with at most this many entries are sorted with insertion sort, which beats quicksort on short rows
+
+// Sorts the column indices of one row (and moves the values along with them) using insertion sort
+static void insertionSortRow(int *cols, double *vals, int length)
+{
+    for (int j = 1; j < length; j++)
+    {
+        int col = cols[j];
+        double val = vals[j];
+        int k = j - 1;
+        while (k >= 0 && cols[k] > col) // shift every larger column one place to the right
+        {
+            cols[k + 1] = cols[k];
+            vals[k + 1] = vals[k];
+            k--;
+        }
+        cols[k + 1] = col;
+        vals[k + 1] = val;
+    }
+}
+
+// Swaps entries i and j of a row, keeping each column index together with its value
+static void swapEntries(int *cols, double *vals, int i, int j)
+{
+    int temp_col = cols[i];
+    cols[i] = cols[j];
+    cols[j] = temp_col;
+    double temp_val = vals[i];
+    vals[i] = vals[j];
+    vals[j] = temp_val;
+}
+
+// Sorts the column indices of one row (and moves the values along with them) using quicksort with a median of three pivot
+static void quickSortRow(int *cols, double *vals, int length)
+{
+    while (length > INSERTION_SORT_ROW_LENGTH)
+    {
+        // order the first, middle and last entries so the middle one is the median and can be used as the pivot
+        int mid = length / 2, last = length - 1;
+        if (cols[mid] < cols[0])
+        {
+            swapEntries(cols, vals, 0, mid);
+        }
+        if (cols[last] < cols[0])
+        {
+            swapEntries(cols, vals, 0, last);
+        }
+        if (cols[last] < cols[mid])
+        {
+            swapEntries(cols, vals, mid, last);
+        }
+        int pivot = cols[mid];
+
+        // Hoare partition: afterwards cols[0..j] <= pivot and cols[j+1..length-1] >= pivot
+        int i = -1, j = length;
+        while (1)
+        {
+            do
+            {
+                i++;
+            } while (cols[i] < pivot);
+            do
+            {
+                j--;
+            } while (cols[j] > pivot);
+            if (i >= j)
+            {
+                break;
+            }
+            swapEntries(cols, vals, i, j);
+        }
+
+        // recurse into the smaller half and loop on the larger half so the recursion depth stays logarithmic
+        int left_length = j + 1;
+        if (left_length < length - left_length)
+        {
+            quickSortRow(cols, vals, left_length);
+            cols += left_length;
+            vals += left_length;
+            length -= left_length;
+        }
+        else
+        {
+            quickSortRow(cols + left_length, vals + left_length, length - left_length);
+            length = left_length;
+        }
+    }
+    insertionSortRow(cols, vals, length); // finish the short leftover part
+}
+
+int rowsAreSorted(const CSRMatrix *matrix)
+{
+    for (int i = 0; i < matrix->num_rows; i++)
+    {
+        for (int j = matrix->row_ptr[i] + 1; j < matrix->row_ptr[i + 1]; j++)
+        {
+            if (matrix->col_ind[j - 1] > matrix->col_ind[j]) // a column smaller than the previous one means the row is out of order
+            {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+void sortRows(CSRMatrix *matrix, int num_threads)
+{
+    if (num_threads < 1)
+    {
+        num_threads = 1;
+    }
+
+    // every row is independent so the rows are shared out between the threads, dynamic scheduling evens out rows of very different lengths
+#pragma omp parallel for schedule(dynamic, 256) num_threads(num_threads)
+    for (int i = 0; i < matrix->num_rows; i++)
+    {
+        int start = matrix->row_ptr[i];
+        int length = matrix->row_ptr[i + 1] - start;
+        if (length <= INSERTION_SORT_ROW_LENGTH)
+        {
+            insertionSortRow(matrix->col_ind + start, matrix->csr_data + start, length);
+        }
+        else
+        {
+            quickSortRow(matrix->col_ind + start, matrix->csr_data + start, length);
+        }
+    }
+    matrix->sorted = 1;
+}
+
+void ensureSorted(CSRMatrix *matrix, int num_threads)
+{
+    if (!matrix->sorted) // nothing to do when the producing kernel already guaranteed sorted rows
+    {
+        sortRows(matrix, num_threads);
+    }
+}
+
+double wallTime(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);   // monotonic clock so the result is not affected by changes to the system time
+    return now.tv_sec + now.tv_nsec * 1e-9; // convert seconds + nanoseconds into seconds
+}
+
+void *allocateOrExit(size_t size, const char *name)
+{
+    void *memory = malloc(size > 0 ? size : 1); // malloc(0) may return NULL, which would look like a failure
+    if (memory == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for %s.\n", name);
+        exit(EXIT_FAILURE);
+    }
+    return memory;
+}
@@ -1,6 +1,8 @@
 #ifndef FUNCTIONS_H
 #define FUNCTIONS_H
 
+#include <stddef.h> // provides size_t
+
 // ###########################################################
 // Do not change this part
 typedef struct {
@@ -10,10 +12,19 @@ typedef struct {
     int num_non_zeros;  // Number of non-zero elements
     int num_rows;       // Number of rows in matrix
     int num_cols;       // Number of columns in matrix
+    int sorted;         // 1 if the column indices inside every row are in increasing order, 0 if they may not be
+    int owns_data;      // 1 if col_ind and csr_data belong to this matrix, 0 for a view that shares them with another matrix
 } CSRMatrix;
 
+// Options for cleaning up the entries of a Matrix Market file while it is being converted to CSR
+typedef struct {
+    int sum_duplicates; // 1 to add up entries which appear more than once at the same (row, column)
+    int drop_zeros;     // 1 to remove entries whose value is exactly zero (checked after duplicates are summed)
+} LoadOptions;
+
 
 void ReadMMtoCSR(const char *filename, CSRMatrix *matrix);
+void ReadMMtoCSRWithOptions(const char *filename, CSRMatrix *matrix, const LoadOptions *options); // same as ReadMMtoCSR but applies the LoadOptions
 /* <Here you can add the declaration of functions you need.>
 <The actual implementation must be in functions.c>
 Here what "potentially" you need:
@@ -28,7 +39,21 @@ CSRMatrix addition(const CSRMatrix *A, const CSRMatrix *B); // add: A + B
 CSRMatrix subtraction(const CSRMatrix *A, const CSRMatrix *B); // subtract: A - B
 CSRMatrix multiplication(const CSRMatrix *A, const CSRMatrix *B); // multiply: C = A * B
 CSRMatrix transpose(const CSRMatrix *A); // transpose: A^T
+CSRMatrix hadamard(const CSRMatrix *A, const CSRMatrix *B); // element-wise product: A .* B, only keeps positions where both have an entry
+// The kernels above drop entries that are exactly zero, the versions below drop every entry with |value| <= drop_tolerance as it is written
+CSRMatrix additionWithTolerance(const CSRMatrix *A, const CSRMatrix *B, double drop_tolerance);
+CSRMatrix subtractionWithTolerance(const CSRMatrix *A, const CSRMatrix *B, double drop_tolerance);
+CSRMatrix multiplicationWithTolerance(const CSRMatrix *A, const CSRMatrix *B, double drop_tolerance);
+CSRMatrix hadamardWithTolerance(const CSRMatrix *A, const CSRMatrix *B, double drop_tolerance);
+void coalesceEntries(CSRMatrix *matrix, int sum_duplicates, int drop_zeros); // sums duplicate (row, column) entries and/or drops explicit zeros in place in O(nnz)
+void spmv(const CSRMatrix *A, const double *x, double *y, int num_threads); // sparse matrix-vector product y = A * x, rows are shared out between num_threads threads
 void printMatrix(const CSRMatrix *matrix); // prints a CSR matrix 
 void freeMatrix(CSRMatrix *matrix); // function to free allocated memory for a CSR matrix
+CSRMatrix copyMatrix(const CSRMatrix *A); // returns a deep copy of A with its own arrays
+int rowsAreSorted(const CSRMatrix *matrix); // returns 1 if the column indices of every row are in increasing order
+void sortRows(CSRMatrix *matrix, int num_threads); // sorts the entries of every row by column index (in parallel) and sets matrix->sorted
+void ensureSorted(CSRMatrix *matrix, int num_threads); // calls sortRows() only when matrix->sorted is not already set
+double wallTime(void); // wall clock time in seconds, used to time threaded code where clock() adds up the time of every thread
+void *allocateOrExit(size_t size, const char *name); // malloc() that prints "Memory allocation failed for <name>" and exits on failure, size 0 gets one byte
 
 #endif
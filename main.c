@@ -4,11 +4,838 @@
 #include <string.h> // provides string functions like strcmp()
 #include "functions.h" // reference header file for function declarations
 #include <time.h> // time library needed for cpu time calculations
+#include "mmwriter.h" // writers used to export the resulting matrix to a file
+#include "reorder.h" // bandwidth reducing orderings and permutations
+#include "compressed.h" // CSR with delta + varint compressed column indices
+#include "bsr.h" // block compressed sparse row format
+#include "estimate.h" // flop count and output size estimates for multiplication
+#include "chain.h" // chain products and matrix powers
+#include "placement.h" // NUMA aware placement of the CSR arrays
+#include "pipeline.h" // loads the two operands of a binary operation concurrently
+#include "submatrix.h" // row views and submatrix extraction
+#include "trisolve.h" // sparse triangular solves
+#include "esc.h" // expand-sort-compress multiplication
+#include "cache.h" // on-disk cache of transpose and multiplication results
+#include "distributed.h" // multiplication split over worker processes
+#ifdef _OPENMP
+#include <omp.h> // provides omp_get_max_threads() when the program is compiled with OpenMP
+#endif
+
+#define SOLVE_BENCH_SECONDS 0.2 // every triangular solve is repeated for at least this long, so tiny matrices still give stable times
+
+// Optional arguments of the form --name=value. They can be placed anywhere after ./main and are removed from argv before the positional arguments are checked
+typedef struct {
+	const char *output_file; // --output=<file.mtx>: write the resulting matrix in Matrix Market format
+	const char *raw_file; // --raw=<file>: write the raw CSR arrays of the resulting matrix
+	int num_threads; // --threads=<n>: number of threads used by the threaded kernels
+	int sort_result; // --sort: sort the columns inside every row of the result before it is printed or exported
+	LoadOptions load; // --sum-duplicates and --drop-zeros: clean up the entries of the input files while they are loaded
+	double drop_tolerance; // --drop-tol=<x>: entries of the result with |value| <= x are dropped (default 0 drops exact zeros only)
+	const char *reorder; // --reorder=<rcm|degree>: run the operation on symmetrically permuted matrices and permute the result back
+	int block_rows, block_cols; // --block=<r>x<c>: block size used by the bsr operation (0 means use the suggested block size)
+	int sampled_rows; // --sample=<n>: number of rows of A sampled by the estimate operation (0 means the default)
+	PlacementPolicy placement; // --numa=<first-touch|interleave|off>: how the pages of the loaded matrices are spread over the NUMA nodes
+	const char *row_list, *col_list; // --rows=<list> and --cols=<list>: rows and columns kept by the extract operation, like 1:100,250
+	int upper; // --upper: the solve operation uses the upper triangle instead of the lower one
+	int unit_diagonal; // --unit-diagonal: the solve operation takes the diagonal to be 1
+	int use_esc; // --spgemm=<marker|esc>: multiplication with the column marker kernel (default) or with expand-sort-compress
+	const char *cache_dir; // --cache=<dir>: keep the results of transpose and multiplication in dir and reuse them
+	int num_workers; // --workers=<n>: multiplication runs in n worker processes (0 means in this process)
+	const char *worker_segment; // --worker=<segment>: set by the launcher, the process only works on that shared memory segment
+} RunOptions;
+
+static void parseOptions(int *argc, char *argv[], RunOptions *options)
+{
+	options->output_file = NULL;
+	options->raw_file = NULL;
+	options->sort_result = 0;
+	options->load.sum_duplicates = 0;
+	options->load.drop_zeros = 0;
+	options->drop_tolerance = 0.0;
+	options->reorder = NULL;
+	options->block_rows = 0;
+	options->block_cols = 0;
+	options->sampled_rows = 0;
+	options->placement = PLACEMENT_FIRST_TOUCH; // only has an effect on machines with more than one NUMA node
+	options->row_list = NULL;
+	options->col_list = NULL;
+	options->upper = 0;
+	options->unit_diagonal = 0;
+	options->use_esc = 0;
+	options->cache_dir = NULL;
+	options->num_workers = 0;
+	options->worker_segment = NULL;
+#ifdef _OPENMP
+	options->num_threads = omp_get_max_threads(); // by default use as many threads as OpenMP would
+#else
+	options->num_threads = 1;
+#endif
+
+	int kept = 1; // argv[0] is always kept
+	for (int i = 1; i < *argc; i++)
+	{
+		if (strncmp(argv[i], "--", 2) != 0) // positional argument, keep it in place
+		{
+			argv[kept++] = argv[i];
+		}
+		else if (strncmp(argv[i], "--output=", 9) == 0)
+		{
+			options->output_file = argv[i] + 9;
+		}
+		else if (strncmp(argv[i], "--raw=", 6) == 0)
+		{
+			options->raw_file = argv[i] + 6;
+		}
+		else if (strncmp(argv[i], "--threads=", 10) == 0 && atoi(argv[i] + 10) > 0)
+		{
+			options->num_threads = atoi(argv[i] + 10);
+		}
+		else if (strcmp(argv[i], "--sort") == 0)
+		{
+			options->sort_result = 1;
+		}
+		else if (strcmp(argv[i], "--sum-duplicates") == 0)
+		{
+			options->load.sum_duplicates = 1;
+		}
+		else if (strcmp(argv[i], "--drop-zeros") == 0)
+		{
+			options->load.drop_zeros = 1;
+		}
+		else if (strncmp(argv[i], "--drop-tol=", 11) == 0 && atof(argv[i] + 11) >= 0)
+		{
+			options->drop_tolerance = atof(argv[i] + 11);
+		}
+		else if (strcmp(argv[i], "--reorder=rcm") == 0 || strcmp(argv[i], "--reorder=degree") == 0)
+		{
+			options->reorder = argv[i] + 10;
+		}
+		else if (sscanf(argv[i], "--block=%dx%d", &options->block_rows, &options->block_cols) == 2 && options->block_rows > 0 && options->block_cols > 0)
+		{
+			// sscanf already stored the block size
+		}
+		else if (strncmp(argv[i], "--sample=", 9) == 0 && atoi(argv[i] + 9) > 0)
+		{
+			options->sampled_rows = atoi(argv[i] + 9);
+		}
+		else if (strcmp(argv[i], "--numa=first-touch") == 0)
+		{
+			options->placement = PLACEMENT_FIRST_TOUCH;
+		}
+		else if (strcmp(argv[i], "--numa=interleave") == 0)
+		{
+			options->placement = PLACEMENT_INTERLEAVE;
+		}
+		else if (strcmp(argv[i], "--numa=off") == 0)
+		{
+			options->placement = PLACEMENT_OFF;
+		}
+		else if (strncmp(argv[i], "--rows=", 7) == 0)
+		{
+			options->row_list = argv[i] + 7;
+		}
+		else if (strncmp(argv[i], "--cols=", 7) == 0)
+		{
+			options->col_list = argv[i] + 7;
+		}
+		else if (strcmp(argv[i], "--upper") == 0)
+		{
+			options->upper = 1;
+		}
+		else if (strcmp(argv[i], "--unit-diagonal") == 0)
+		{
+			options->unit_diagonal = 1;
+		}
+		else if (strcmp(argv[i], "--spgemm=marker") == 0 || strcmp(argv[i], "--spgemm=esc") == 0)
+		{
+			options->use_esc = strcmp(argv[i] + 9, "esc") == 0;
+		}
+		else if (strncmp(argv[i], "--cache=", 8) == 0 && argv[i][8] != '\0')
+		{
+			options->cache_dir = argv[i] + 8;
+		}
+		else if (strncmp(argv[i], "--workers=", 10) == 0 && atoi(argv[i] + 10) > 0)
+		{
+			options->num_workers = atoi(argv[i] + 10);
+		}
+		else if (strncmp(argv[i], "--worker=", 9) == 0 && argv[i][9] == '/')
+		{
+			options->worker_segment = argv[i] + 9;
+		}
+		else
+		{
+			fprintf(stderr, "Error: Unknown option %s. Supported options are --output=<file.mtx>, --raw=<file>, --threads=<n>, --sort, --sum-duplicates, --drop-zeros, --drop-tol=<x>, --reorder=<rcm|degree>, --block=<r>x<c>, --sample=<n>, --numa=<first-touch|interleave|off>, --rows=<list>, --cols=<list>, --upper, --unit-diagonal, --spgemm=<marker|esc>, --cache=<dir> and --workers=<n>\n", argv[i]);
+			exit(EXIT_FAILURE);
+		}
+	}
+	argv[kept] = NULL;
+	*argc = kept;
+}
+
+/* Reads a matrix file and spreads its pages over the NUMA nodes. The loader fills the arrays with one thread, so without the
+placement every page would sit on the node of that thread and the threaded kernels would share its memory bandwidth. */
+static void loadMatrix(const char *filename, CSRMatrix *matrix, const RunOptions *options)
+{
+	ReadMMtoCSRWithOptions(filename, matrix, &options->load);
+	placeMatrix(matrix, options->placement, options->num_threads);
+}
+
+// Writes the resulting matrix to the files requested with --output and --raw and reports how long it took
+static void exportResult(const CSRMatrix *matrix, const RunOptions *options)
+{
+	if (options->output_file == NULL && options->raw_file == NULL)
+	{
+		return; // nothing to export
+	}
+
+	double start_time = wallTime();
+	if (options->output_file != NULL)
+	{
+		writeMMfromCSR(options->output_file, matrix, options->num_threads);
+	}
+	if (options->raw_file != NULL)
+	{
+		writeCSRArrays(options->raw_file, matrix);
+	}
+	printf("Export time: %f seconds\n", wallTime() - start_time);
+	printf("\n");
+}
+
+// Computes the symmetric ordering selected with --reorder (reverse Cuthill-McKee by default) for matrix A
+static int *computeOrdering(const CSRMatrix *A, const char *method)
+{
+	if (A->num_rows != A->num_cols) // a symmetric permutation P A P^T only exists for square matrices
+	{
+		fprintf(stderr, "Error: Reordering needs square matrices.\n");
+		exit(EXIT_FAILURE);
+	}
+	if (method != NULL && strcmp(method, "degree") == 0)
+	{
+		return degreeOrdering(A);
+	}
+	return reverseCuthillMcKee(A);
+}
+
+// Prints how the reordering changed the bandwidth and profile of a matrix
+static void reportReordering(const char *name, const CSRMatrix *before, const CSRMatrix *after)
+{
+	printf("Bandwidth of %s: %d before, %d after reordering\n", name, matrixBandwidth(before), matrixBandwidth(after));
+	printf("Profile of %s: %lld before, %lld after reordering\n", name, matrixProfile(before), matrixProfile(after));
+}
+
+// Number of times a kernel is repeated in the benchmarks so that small matrices still give measurable times
+static int benchmarkRepetitions(int num_non_zeros)
+{
+	int repetitions = 20000000 / (num_non_zeros > 0 ? num_non_zeros : 1); // roughly 20 million multiply-adds per benchmark
+	return repetitions > 0 ? repetitions : 1;
+}
+
+// Compares plain CSR and compressed CSR: index compression ratio, SpMV throughput and transpose time
+static void benchCompressed(const CSRMatrix *A, const RunOptions *options)
+{
+	double start_time = wallTime();
+	CompressedCSRMatrix A_compressed = compressCSR(A, options->num_threads);
+	double compress_time = wallTime() - start_time;
+
+	size_t plain_index_bytes = (size_t)A->num_non_zeros * sizeof(int);
+	size_t compressed_index_bytes = A_compressed.num_bytes + (size_t)(A->num_rows + 1) * sizeof(size_t); // the byte stream plus the per-row offsets
+	size_t shared_bytes = (size_t)A->num_non_zeros * sizeof(double) + (size_t)(A->num_rows + 1) * sizeof(int); // values and row pointers are the same in both formats
+	printf("Column index bytes: %zu plain, %zu compressed (ratio %.2f)\n", plain_index_bytes, compressed_index_bytes,
+		   compressed_index_bytes > 0 ? (double)plain_index_bytes / compressed_index_bytes : 0.0);
+	printf("Total matrix bytes: %zu plain, %zu compressed (ratio %.2f)\n", plain_index_bytes + shared_bytes, compressed_index_bytes + shared_bytes,
+		   (double)(plain_index_bytes + shared_bytes) / (compressed_index_bytes + shared_bytes));
+	printf("Compression time: %f seconds\n", compress_time);
+
+	// SpMV with x = 1, repeated enough times to get a stable time
+	double *x = (double *)malloc((A->num_cols > 0 ? A->num_cols : 1) * sizeof(double));
+	double *y_plain = (double *)malloc((A->num_rows > 0 ? A->num_rows : 1) * sizeof(double));
+	double *y_compressed = (double *)malloc((A->num_rows > 0 ? A->num_rows : 1) * sizeof(double));
+	if (x == NULL || y_plain == NULL || y_compressed == NULL)
+	{
+		fprintf(stderr, "Error: Memory allocation failed for the SpMV vectors.\n");
+		exit(EXIT_FAILURE);
+	}
+	for (int i = 0; i < A->num_cols; i++)
+	{
+		x[i] = 1.0;
+	}
+
+	int repetitions = benchmarkRepetitions(A->num_non_zeros);
+	start_time = wallTime();
+	for (int r = 0; r < repetitions; r++)
+	{
+		spmv(A, x, y_plain, options->num_threads);
+	}
+	double plain_time = (wallTime() - start_time) / repetitions;
+	start_time = wallTime();
+	for (int r = 0; r < repetitions; r++)
+	{
+		spmvCompressed(&A_compressed, x, y_compressed, options->num_threads);
+	}
+	double compressed_time = (wallTime() - start_time) / repetitions;
+
+	double max_difference = 0.0; // the compressed SpMV may add up a row in a different (sorted) order, so only tiny differences are expected
+	for (int i = 0; i < A->num_rows; i++)
+	{
+		double difference = y_plain[i] > y_compressed[i] ? y_plain[i] - y_compressed[i] : y_compressed[i] - y_plain[i];
+		if (difference > max_difference)
+		{
+			max_difference = difference;
+		}
+	}
+
+	// traffic of one SpMV: the matrix itself plus reading x and writing y
+	double vector_bytes = (double)(A->num_cols + A->num_rows) * sizeof(double);
+	printf("SpMV plain: %f seconds, %.3f GFLOP/s, %.3f GB/s\n", plain_time, 2.0 * A->num_non_zeros / plain_time / 1e9,
+		   (plain_index_bytes + shared_bytes + vector_bytes) / plain_time / 1e9);
+	printf("SpMV compressed: %f seconds, %.3f GFLOP/s, %.3f GB/s\n", compressed_time, 2.0 * A->num_non_zeros / compressed_time / 1e9,
+		   (compressed_index_bytes + shared_bytes + vector_bytes) / compressed_time / 1e9);
+	printf("SpMV speedup: %.2f, largest difference in y: %g\n", plain_time / compressed_time, max_difference);
+
+	start_time = wallTime();
+	CSRMatrix T_plain = transpose(A);
+	double transpose_plain_time = wallTime() - start_time;
+	start_time = wallTime();
+	CSRMatrix T_compressed = transposeCompressed(&A_compressed);
+	double transpose_compressed_time = wallTime() - start_time;
+	printf("Transpose plain: %f seconds, compressed: %f seconds\n", transpose_plain_time, transpose_compressed_time);
+	printf("\n");
+
+	free(x);
+	free(y_plain);
+	free(y_compressed);
+	freeMatrix(&T_plain);
+	freeMatrix(&T_compressed);
+	freeCompressedMatrix(&A_compressed);
+}
+
+// Largest absolute difference between the entries of two matrices of the same size, used to check the alternative kernels against the CSR ones
+static double maxDifference(const CSRMatrix *X, const CSRMatrix *Y)
+{
+	CSRMatrix D = subtraction(X, Y);
+	coalesceEntries(&D, 1, 0); // without --sum-duplicates a position can be stored more than once, only the sum of its entries counts
+	double max_difference = 0.0;
+	for (int i = 0; i < D.num_non_zeros; i++)
+	{
+		double difference = D.csr_data[i] < 0 ? -D.csr_data[i] : D.csr_data[i];
+		if (difference > max_difference)
+		{
+			max_difference = difference;
+		}
+	}
+	freeMatrix(&D);
+	return max_difference;
+}
+
+// Compares the BSR kernels against the CSR kernels for SpMV, A + A and (for square matrices) A * A
+static void benchBSR(const CSRMatrix *A, const RunOptions *options)
+{
+	int r, c;
+	double estimated_fill;
+	suggestBlockSize(A, &r, &c, &estimated_fill);
+	printf("Suggested block size: %dx%d (estimated fill ratio %.3f)\n", r, c, estimated_fill);
+	if (options->block_rows > 0) // --block overrides the suggestion
+	{
+		r = options->block_rows;
+		c = options->block_cols;
+	}
+
+	double start_time = wallTime();
+	BSRMatrix A_bsr = csrToBSR(A, r, c);
+	double convert_time = wallTime() - start_time;
+	printf("Block size used: %dx%d, %d blocks, fill ratio %.3f, conversion time %f seconds\n", r, c, A_bsr.num_blocks, bsrFillRatio(&A_bsr), convert_time);
+
+	// SpMV with x = 1
+	double *x = (double *)malloc((A->num_cols > 0 ? A->num_cols : 1) * sizeof(double));
+	double *y_plain = (double *)malloc((A->num_rows > 0 ? A->num_rows : 1) * sizeof(double));
+	double *y_bsr = (double *)malloc((A->num_rows > 0 ? A->num_rows : 1) * sizeof(double));
+	if (x == NULL || y_plain == NULL || y_bsr == NULL)
+	{
+		fprintf(stderr, "Error: Memory allocation failed for the SpMV vectors.\n");
+		exit(EXIT_FAILURE);
+	}
+	for (int i = 0; i < A->num_cols; i++)
+	{
+		x[i] = 1.0;
+	}
+	int repetitions = benchmarkRepetitions(A->num_non_zeros);
+	start_time = wallTime();
+	for (int k = 0; k < repetitions; k++)
+	{
+		spmv(A, x, y_plain, options->num_threads);
+	}
+	double plain_time = (wallTime() - start_time) / repetitions;
+	start_time = wallTime();
+	for (int k = 0; k < repetitions; k++)
+	{
+		spmvBSR(&A_bsr, x, y_bsr, options->num_threads);
+	}
+	double bsr_time = (wallTime() - start_time) / repetitions;
+	double max_difference = 0.0;
+	for (int i = 0; i < A->num_rows; i++)
+	{
+		double difference = y_plain[i] > y_bsr[i] ? y_plain[i] - y_bsr[i] : y_bsr[i] - y_plain[i];
+		if (difference > max_difference)
+		{
+			max_difference = difference;
+		}
+	}
+	printf("SpMV CSR: %f seconds, BSR: %f seconds (speedup %.2f, largest difference %g)\n", plain_time, bsr_time, plain_time / bsr_time, max_difference);
+
+	// A + A
+	start_time = wallTime();
+	CSRMatrix sum_plain = addition(A, A);
+	plain_time = wallTime() - start_time;
+	start_time = wallTime();
+	BSRMatrix sum_bsr = bsrAddition(&A_bsr, &A_bsr, options->num_threads);
+	bsr_time = wallTime() - start_time;
+	CSRMatrix sum_check = bsrToCSR(&sum_bsr);
+	printf("A + A CSR: %f seconds, BSR: %f seconds (largest difference %g)\n", plain_time, bsr_time, maxDifference(&sum_plain, &sum_check));
+	freeMatrix(&sum_plain);
+	freeMatrix(&sum_check);
+	freeBSRMatrix(&sum_bsr);
+
+	// A * A, the right hand copy of A is blocked with c x c blocks so its block rows line up with the block columns of A_bsr
+	if (A->num_rows == A->num_cols)
+	{
+		BSRMatrix A_right = csrToBSR(A, c, c);
+		start_time = wallTime();
+		CSRMatrix product_plain = multiplication(A, A);
+		plain_time = wallTime() - start_time;
+		start_time = wallTime();
+		BSRMatrix product_bsr = bsrMultiplication(&A_bsr, &A_right, options->num_threads);
+		bsr_time = wallTime() - start_time;
+		CSRMatrix product_check = bsrToCSR(&product_bsr);
+		printf("A * A CSR: %f seconds, BSR: %f seconds (largest difference %g)\n", plain_time, bsr_time, maxDifference(&product_plain, &product_check));
+		freeMatrix(&product_plain);
+		freeMatrix(&product_check);
+		freeBSRMatrix(&product_bsr);
+		freeBSRMatrix(&A_right);
+	}
+	printf("\n");
+
+	free(x);
+	free(y_plain);
+	free(y_bsr);
+	freeBSRMatrix(&A_bsr);
+}
+
+// Prints the statistics of a chain product or matrix power
+static void reportChain(const ChainStats *stats, double compute_time)
+{
+	printf("Multiplications: %d (%lld multiply-adds)\n", stats->multiplications, stats->total_flops);
+	printf("Peak intermediate nnz: %lld\n", stats->peak_non_zeros);
+	printf("Peak intermediate memory: %.1f MB\n", stats->peak_bytes / 1e6);
+	printf("Compute time: %f seconds\n", compute_time);
+	printf("\n");
+}
+
+/* Turns a list like "1:100,250,300:310" (1-based and inclusive, as in Matrix Market files) into 0-based indices. Every index
+must be between 1 and limit. */
+static int *parseIndexList(const char *text, int limit, int *count)
+{
+	// first walk counts the indices, second walk stores them
+	int *indices = NULL;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		const char *position = text;
+		int stored = 0;
+		while (*position != '\0')
+		{
+			char *end;
+			long first = strtol(position, &end, 10), last;
+			if (end == position)
+			{
+				fprintf(stderr, "Error: Could not read the index list %s\n", text);
+				exit(EXIT_FAILURE);
+			}
+			last = first;
+			position = end;
+			if (*position == ':')
+			{
+				last = strtol(position + 1, &end, 10);
+				position = end;
+			}
+			if (first < 1 || last > limit || first > last)
+			{
+				fprintf(stderr, "Error: Index range %ld:%ld is outside of 1:%d\n", first, last, limit);
+				exit(EXIT_FAILURE);
+			}
+			for (long index = first; index <= last; index++)
+			{
+				if (pass == 1)
+				{
+					indices[stored] = (int)index - 1;
+				}
+				stored++;
+			}
+			if (*position == ',')
+			{
+				position++;
+			}
+		}
+		if (pass == 0)
+		{
+			indices = (int *)malloc((stored > 0 ? stored : 1) * sizeof(int));
+			if (indices == NULL)
+			{
+				fprintf(stderr, "Error: Memory allocation failed for the index list.\n");
+				exit(EXIT_FAILURE);
+			}
+		}
+		*count = stored;
+	}
+	return indices;
+}
+
+/* ./main <file.mtx> extract <print> with --rows and/or --cols. A single contiguous row range without --cols becomes a
+zero-copy view, everything else is built with the two-pass extraction. */
+static CSRMatrix extractFromOptions(const CSRMatrix *A, const RunOptions *options)
+{
+	int num_rows = 0, num_cols = 0;
+	int *rows = options->row_list != NULL ? parseIndexList(options->row_list, A->num_rows, &num_rows) : NULL;
+	int *cols = options->col_list != NULL ? parseIndexList(options->col_list, A->num_cols, &num_cols) : NULL;
+
+	int contiguous = 1;
+	for (int i = 1; rows != NULL && i < num_rows; i++)
+	{
+		contiguous = contiguous && rows[i] == rows[0] + i;
+	}
+
+	CSRMatrix C;
+	double start_time = wallTime();
+	if (cols == NULL && (rows == NULL || contiguous))
+	{
+		int first_row = rows != NULL && num_rows > 0 ? rows[0] : 0;
+		C = rowRangeView(A, first_row, rows != NULL ? first_row + num_rows : A->num_rows);
+		printf("Row view (shares the arrays of A): ");
+	}
+	else
+	{
+		C = extractSubmatrix(A, rows, num_rows, cols, num_cols, options->num_threads);
+		printf("Extracted submatrix: ");
+	}
+	double extract_time = wallTime() - start_time;
+	printf("%d x %d with %d non-zeros, %f seconds\n", C.num_rows, C.num_cols, C.num_non_zeros, extract_time);
+	printf("\n");
+
+	free(rows);
+	free(cols);
+	return C;
+}
+
+// Largest difference between x and the exact solution, which is all ones
+static double solveError(const double *x, int n)
+{
+	double error = 0.0;
+	for (int i = 0; i < n; i++)
+	{
+		double difference = x[i] > 1.0 ? x[i] - 1.0 : 1.0 - x[i];
+		error = difference > error ? difference : error;
+	}
+	return error;
+}
+
+// The four ways benchTriangular() solves T x = b
+enum { SOLVE_ROWS, SOLVE_COLUMNS, SOLVE_LEVELS, SOLVE_SYNC_FREE };
+
+/* Time of one solve with the given method. A fixed number of repetitions does not work here: a parallel solve opens an OpenMP
+region every time, which costs far more than the whole solve of a tiny matrix. So the solve is repeated until
+SOLVE_BENCH_SECONDS have passed, whatever the size of the matrix. */
+static double timeSolve(int method, const CSRMatrix *A, const CSRMatrix *A_transpose, const TriangularPlan *plan, int lower,
+						const RunOptions *options, const double *b, double *x)
+{
+	int repetitions = 0;
+	double start_time = wallTime(), elapsed;
+	do
+	{
+		if (method == SOLVE_ROWS)
+		{
+			solveTriangularSerial(A, lower, options->unit_diagonal, b, x);
+		}
+		else if (method == SOLVE_COLUMNS)
+		{
+			solveTriangularColumns(A_transpose, lower, options->unit_diagonal, b, x);
+		}
+		else if (method == SOLVE_LEVELS)
+		{
+			solveTriangularLevels(A, plan, b, x, options->num_threads);
+		}
+		else
+		{
+			solveTriangularSyncFree(A, plan, b, x, options->num_threads);
+		}
+		repetitions++;
+		elapsed = wallTime() - start_time;
+	} while (elapsed < SOLVE_BENCH_SECONDS);
+	return elapsed / repetitions;
+}
+
+/* Solves T x = b for the triangle T of A chosen with --upper and --unit-diagonal, where b = T * ones so the exact solution is
+known, and compares the serial row and column substitutions with the level set and sync-free parallel solves. */
+static void benchTriangular(const CSRMatrix *A, const RunOptions *options)
+{
+	if (A->num_rows != A->num_cols) // checked before b = T * ones, which reads num_cols entries of a vector of num_rows ones
+	{
+		fprintf(stderr, "Error: Triangular solves need a square matrix.\n");
+		exit(EXIT_FAILURE);
+	}
+	int n = A->num_rows;
+	int lower = !options->upper;
+	double *ones = (double *)malloc((n > 0 ? n : 1) * sizeof(double));
+	double *b = (double *)malloc((n > 0 ? n : 1) * sizeof(double));
+	double *x = (double *)malloc((n > 0 ? n : 1) * sizeof(double));
+	if (ones == NULL || b == NULL || x == NULL)
+	{
+		fprintf(stderr, "Error: Memory allocation failed for the triangular solve vectors.\n");
+		exit(EXIT_FAILURE);
+	}
+	for (int i = 0; i < n; i++)
+	{
+		ones[i] = 1.0;
+	}
+	triangularMultiply(A, lower, options->unit_diagonal, ones, b);
+	printf("Solving %s x = b with a %s diagonal\n", lower ? "L" : "U", options->unit_diagonal ? "unit" : "stored");
+
+	double serial_time = timeSolve(SOLVE_ROWS, A, NULL, NULL, lower, options, b, x);
+	printf("Serial row solve: %e seconds (largest error %g)\n", serial_time, solveError(x, n));
+
+	double start_time = wallTime();
+	CSRMatrix A_transpose = transpose(A);
+	double transpose_time = wallTime() - start_time;
+	double column_time = timeSolve(SOLVE_COLUMNS, A, &A_transpose, NULL, lower, options, b, x);
+	printf("Serial column solve: %e seconds after a %e second transpose (largest error %g)\n", column_time, transpose_time, solveError(x, n));
+
+	TriangularPlan plan;
+	start_time = wallTime();
+	analyseTriangular(A, lower, options->unit_diagonal, &plan);
+	double analysis_time = wallTime() - start_time;
+	printf("Analysis: %d levels, %.1f rows per level on average, %e seconds\n", plan.num_levels,
+		   plan.num_levels > 0 ? (double)n / plan.num_levels : 0.0, analysis_time);
+
+	double levels_time = timeSolve(SOLVE_LEVELS, A, NULL, &plan, lower, options, b, x);
+	printf("Level set solve (%d threads): %e seconds, speedup %.3g (largest error %g)\n", options->num_threads, levels_time,
+		   levels_time > 0 ? serial_time / levels_time : 0.0, solveError(x, n));
+
+	double sync_free_time = timeSolve(SOLVE_SYNC_FREE, A, NULL, &plan, lower, options, b, x);
+	printf("Sync-free solve (%d threads): %e seconds, speedup %.3g (largest error %g)\n", options->num_threads, sync_free_time,
+		   sync_free_time > 0 ? serial_time / sync_free_time : 0.0, solveError(x, n));
+	printf("\n");
+
+	freeTriangularPlan(&plan);
+	freeMatrix(&A_transpose);
+	free(ones);
+	free(b);
+	free(x);
+}
+
+// Prints how the concurrent loading of A and B went
+static void reportLoad(const LoadReport *report)
+{
+	printf("Load time: A %f seconds, B %f seconds, %f seconds wall time for both\n", report->load_time_A, report->load_time_B, report->wall_time);
+	printf("Analysis of A while B was loading: %f seconds (rows %d to %d entries long, %.2f on average, %d empty)\n", report->symbolic_time,
+		   report->rows_A.min_row, report->rows_A.max_row, report->rows_A.mean_row, report->rows_A.empty_rows);
+	if (report->flops >= 0)
+	{
+		printf("Multiply-adds of A * B: %lld\n", report->flops);
+	}
+}
+
+/* Describes the requested operation for the result cache, with every option that changes its result, or returns NULL when the
+cache is off or the operation is not cached. The kernel is part of the description because the two kernels order the entries
+of a row differently. */
+static const char *cachedOperation(int argc, char *argv[], const RunOptions *options, char *description, size_t size)
+{
+	if (options->cache_dir == NULL)
+	{
+		return NULL;
+	}
+	if (argc == 4 && strcmp(argv[2], "transpose") == 0)
+	{
+		snprintf(description, size, "transpose");
+		return description;
+	}
+	if (argc == 5 && strcmp(argv[3], "multiplication") == 0)
+	{
+		snprintf(description, size, "multiplication kernel=%s drop-tol=%.17g reorder=%s", options->use_esc ? "esc" : "marker",
+				 options->drop_tolerance, options->reorder != NULL ? options->reorder : "none");
+		return description;
+	}
+	return NULL;
+}
+
+// Prints how the result cache did in this run and over all runs that used the same directory
+static void reportCache(const ResultCache *cache)
+{
+	printf("Result cache: %d hit(s), %d miss(es) in this run, %lld hit(s) and %lld miss(es) in total\n", cache->hits, cache->misses,
+		   cache->total_hits + cache->hits, cache->total_misses + cache->misses);
+	printf("Input hashes: %d taken from stamps, %d computed in %f seconds; lookup %f seconds, store %f seconds\n",
+		   cache->hashes_reused, cache->hashes_computed, cache->hash_time, cache->lookup_time, cache->store_time);
+}
+
+// Prints what every worker process was sent and returned, and how the time of the distributed multiplication was spent
+static void reportDistributed(const DistributedReport *report)
+{
+	long long bytes_sent = 0, bytes_returned = 0;
+	for (int w = 0; w < report->num_workers; w++)
+	{
+		const WorkerReport *worker = &report->workers[w];
+		printf("Worker %d: rows %d to %d, sent %d entries of A and %d rows (%d entries) of B, %.2f MB in, %.2f MB out, compute %f seconds, %f seconds from launch to exit\n",
+			   w, worker->first_row + 1, worker->last_row, worker->nnz_A, worker->rows_B, worker->nnz_B, worker->bytes_sent / 1e6,
+			   worker->bytes_returned / 1e6, worker->compute_time, worker->elapsed_time);
+		bytes_sent += worker->bytes_sent;
+		bytes_returned += worker->bytes_returned;
+	}
+	printf("Communication: %.2f MB to the workers, %.2f MB back, %.2f MB in total\n", bytes_sent / 1e6, bytes_returned / 1e6,
+		   (bytes_sent + bytes_returned) / 1e6);
+	printf("Partition and pack time: %f seconds, workers: %f seconds, stitch time: %f seconds\n", report->pack_time, report->run_time,
+		   report->stitch_time);
+}
+
+/* ./main <file1.mtx> <file2.mtx> ... <fileN.mtx> chain <print>: multiplies all the files in the order that the estimated
+flops and intermediate sizes say is cheapest. This is the only command with more than two input files. */
+static void runChain(int argc, char *argv[], const RunOptions *options)
+{
+	int count = argc - 3;
+	CSRMatrix *matrices = (CSRMatrix *)malloc(count * sizeof(CSRMatrix));
+	const CSRMatrix **chain = (const CSRMatrix **)malloc(count * sizeof(CSRMatrix *));
+	int *split = (int *)malloc((size_t)count * count * sizeof(int));
+	char *order = (char *)malloc(16 * (size_t)count + 1);
+	if (matrices == NULL || chain == NULL || split == NULL || order == NULL)
+	{
+		fprintf(stderr, "Error: Memory allocation failed for the chain.\n");
+		exit(EXIT_FAILURE);
+	}
+	for (int i = 0; i < count; i++)
+	{
+		loadMatrix(argv[i + 1], &matrices[i], options);
+		chain[i] = &matrices[i];
+	}
+
+	double start_time = wallTime();
+	double estimated_cost = chainOrder(chain, count, split);
+	double order_time = wallTime() - start_time;
+	describeChainOrder(split, count, order, 16 * (size_t)count + 1);
+
+	ChainStats stats;
+	start_time = wallTime();
+	CSRMatrix C = chainProduct(chain, count, split, options->drop_tolerance, &stats); // reuses the order printed above instead of estimating it again
+	double compute_time = wallTime() - start_time;
+
+	if (options->sort_result)
+	{
+		ensureSorted(&C, options->num_threads);
+	}
+	if (atoi(argv[argc - 1]) == 1)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			printf("Matrix M%d:\n", i + 1);
+			printMatrix(&matrices[i]);
+			printf("\n");
+		}
+		printf("Resultant Matrix C:\n");
+		printMatrix(&C);
+		printf("\n");
+	}
+	printf("Multiplication order: %s (estimated cost %.0f, found in %f seconds)\n", order, estimated_cost, order_time);
+	printf("Result nnz: %d\n", C.num_non_zeros);
+	reportChain(&stats, compute_time);
+
+	exportResult(&C, options);
+
+	for (int i = 0; i < count; i++)
+	{
+		freeMatrix(&matrices[i]);
+	}
+	freeMatrix(&C);
+	free(matrices);
+	free(chain);
+	free(split);
+	free(order);
+}
+
+// Prints where the pages of a matrix are and the SpMV bandwidth the threads of every node reach on it
+static void reportNodeBandwidth(const char *name, const CSRMatrix *A, const double *x, double *y, const RunOptions *options)
+{
+	long long value_pages[PLACEMENT_MAX_NODES], index_pages[PLACEMENT_MAX_NODES];
+	int known = pagesPerNode(A->csr_data, (size_t)A->num_non_zeros * sizeof(double), value_pages) &&
+				pagesPerNode(A->col_ind, (size_t)A->num_non_zeros * sizeof(int), index_pages);
+	long long total_pages = 0;
+	for (int n = 0; n < PLACEMENT_MAX_NODES; n++)
+	{
+		total_pages += known ? value_pages[n] + index_pages[n] : 0;
+	}
+
+	NodeBandwidth bandwidth;
+	spmvNodeBandwidth(A, x, y, options->num_threads, benchmarkRepetitions(A->num_non_zeros), &bandwidth);
+
+	double total_bytes = 0.0, slowest = 0.0;
+	printf("%s:\n", name);
+	for (int n = 0; n < numaNodeCount() && n < PLACEMENT_MAX_NODES; n++)
+	{
+		total_bytes += bandwidth.bytes[n];
+		slowest = bandwidth.seconds[n] > slowest ? bandwidth.seconds[n] : slowest;
+		printf("  node %d: %d threads, ", n, bandwidth.threads[n]);
+		if (known && total_pages > 0)
+		{
+			printf("%.1f%% of the matrix pages, ", 100.0 * (value_pages[n] + index_pages[n]) / total_pages);
+		}
+		printf("%.3f GB/s\n", bandwidth.seconds[n] > 0 ? bandwidth.bytes[n] / bandwidth.seconds[n] / 1e9 : 0.0);
+	}
+	printf("  total: %.3f GB/s\n", slowest > 0 ? total_bytes / slowest / 1e9 : 0.0);
+}
+
+/* Compares SpMV on a copy of A filled by a single thread (the layout every matrix had before) against A as it was placed at
+load time with --numa, per NUMA node. On a machine with one node the two layouts are the same. */
+static void benchPlacement(const CSRMatrix *A, const RunOptions *options)
+{
+	int nodes = numaNodeCount();
+	const char *policy = options->placement == PLACEMENT_INTERLEAVE ? "interleave" : options->placement == PLACEMENT_FIRST_TOUCH ? "first-touch" : "off";
+	printf("NUMA nodes: %d, threads: %d, placement: %s\n", nodes, options->num_threads, policy);
+	if (nodes < 2)
+	{
+		printf("Single node machine: every page is local, placement is skipped\n");
+	}
+
+	// x is read by every thread, so it is interleaved whenever placement is on, y is written with the row partition of the kernels
+	double *x = allocatePlacedVector(A->num_cols, options->placement == PLACEMENT_OFF ? PLACEMENT_OFF : PLACEMENT_INTERLEAVE, options->num_threads);
+	double *y = allocatePlacedVector(A->num_rows, options->placement, options->num_threads);
+	for (int i = 0; i < A->num_cols; i++)
+	{
+		x[i] = 1.0;
+	}
+
+	CSRMatrix serial = copyMatrix(A); // copied by one thread, so its pages are all on that thread's node
+	reportNodeBandwidth("Filled by one thread", &serial, x, y, options);
+	reportNodeBandwidth("Placed", A, x, y, options);
+	printf("\n");
+
+	freeMatrix(&serial);
+	free(x);
+	free(y);
+}
 
 int main(int argc, char *argv[]) 
 {
 	// <<Your CODE: Handle the inputs here>
 
+	double program_start = wallTime(); // start of the end-to-end wall time, which includes loading the files
+	RunOptions options;
+	parseOptions(&argc, argv, &options); // strip the optional --name=value arguments first
+
+	if (options.worker_segment != NULL) // started by the launcher of a distributed multiplication, there are no files to read
+	{
+		runWorker(options.worker_segment);
+		exit(EXIT_SUCCESS);
+	}
+
+	if (argc >= 5 && strcmp(argv[argc - 2], "chain") == 0) // a chain can have any number of files, so it is checked before the argument count
+	{
+		runChain(argc, argv, &options);
+		exit(EXIT_SUCCESS);
+	}
+
 	if (argc < 2 || argc > 5) // check whether a valid amount of arguments have been passed, at least 1 argument are needed as the fewest arguments that can be passed are: "./main" and "file"
 	// more than 4 parameters cannot be passed either meaning argc cant be greater than 5
 	{
@@ -22,15 +849,61 @@ int main(int argc, char *argv[])
         exit(EXIT_FAILURE); // terminate program 
 	}
 
+	/* With --cache the result of transpose and multiplication can come from an earlier run. When the stamps say the input files
+	did not change and nothing has to be printed, a hit does not even read the input files. */
+	ResultCache cache;
+	char operation_description[128];
+	const char *cached_operation = cachedOperation(argc, argv, &options, operation_description, sizeof(operation_description));
+	if (cached_operation != NULL)
+	{
+		openResultCache(&cache, options.cache_dir);
+		CSRMatrix C;
+		if (atoi(argv[argc - 1]) != 1 && stampedResult(&cache, cached_operation, argv + 1, argc - 3, &options.load, &C))
+		{
+			if (options.sort_result)
+			{
+				ensureSorted(&C, options.num_threads);
+			}
+			printf("Result taken from the cache without reading the input files\n");
+			reportCache(&cache);
+			printf("End-to-end wall time: %f seconds\n", wallTime() - program_start);
+			printf("\n");
+			exportResult(&C, &options);
+			closeResultCache(&cache);
+			freeMatrix(&C);
+			exit(EXIT_SUCCESS);
+		}
+	}
+
 	const char *filename_1 = argv[1]; // file 1 is the first argument
 	CSRMatrix A; // initalize matrix A
-	ReadMMtoCSR(filename_1, &A); // read the file and assign it to matix A
+	CSRMatrix B; // initialize matrix B, only used by the operations with two files
+	LoadReport load_report;
+	if (argc == 5 && strcmp(argv[2], "power") != 0) // two files: read them at the same time
+	{
+		loadOperands(filename_1, argv[2], &A, &B, &options.load, &load_report);
+		placeMatrix(&A, options.placement, options.num_threads); // placed after both loads so all threads take part in the first touch
+		placeMatrix(&B, options.placement, options.num_threads);
+	}
+	else
+	{
+		loadMatrix(filename_1, &A, &options); // read the file and assign it to matix A
+	}
 
 
 	if (argc == 2) // if only the file name is passed print the matrix
 	{
-		printMatrix(&A); // print matrix A
-		printf("\n"); // empty line for spacing
+		if (options.sort_result)
+		{
+			ensureSorted(&A, options.num_threads); // only sorts when the file was not already in sorted order
+		}
+		if (options.output_file == NULL && options.raw_file == NULL) // when an output file is given the matrix is converted instead of printed
+		{
+			printMatrix(&A); // print matrix A
+			printf("\n"); // empty line for spacing
+		}
+		exportResult(&A, &options);
+		freeMatrix(&A);
 		exit(EXIT_SUCCESS); // indicates the program has completed and terminates, equivalent to "return 0"
 	}
 	
@@ -46,12 +919,30 @@ int main(int argc, char *argv[])
 		double cpu_time_used;
 		start_time = clock();
 
-        CSRMatrix A_transpose = transpose(&A); // compute the transpose of A and assign it to the CSRMatrix AT
+		CSRMatrix A_transpose;
+		unsigned long long cache_key = 0;
+		const CSRMatrix *inputs[1] = {&A};
+		int cache_hit = cached_operation != NULL &&
+						cachedResult(&cache, cached_operation, argv + 1, inputs, 1, &options.load, options.num_threads, &cache_key, &A_transpose);
+		if (!cache_hit)
+		{
+			A_transpose = transpose(&A); // compute the transpose of A and assign it to the CSRMatrix AT
+		}
 
 		// end cpu timer 
 		end_time = clock();
 		cpu_time_used = ((double)(end_time - start_time)) / CLOCKS_PER_SEC;
 
+		if (cached_operation != NULL)
+		{
+			if (!cache_hit)
+			{
+				storeResult(&cache, cache_key, &A_transpose);
+			}
+			reportCache(&cache);
+			closeResultCache(&cache);
+		}
+
         // Check if print argument is provided
         if (atoi(argv[3]) == 1) // check if the user wants the matriced to be printed
 		{
@@ -69,41 +960,256 @@ int main(int argc, char *argv[])
 			printf("CPU time: %f seconds\n", cpu_time_used); // print the cpu time for the operation as we need this to compare the multiplication function with the python implementation
 			printf("\n");
 		}
+
+		exportResult(&A_transpose, &options); // write A^T to the requested output files, if any
 		
         freeMatrix(&A); // free allocated memory for matix A
         freeMatrix(&A_transpose); // free allocated memory for matix AT
         exit(EXIT_SUCCESS); // indicates the program has completed and terminates, equivalent to "return 0"
     } 
+	else if (argc == 4 && (strcmp(argv[2], "reorder") == 0)) // reorder A with the method from --reorder (reverse Cuthill-McKee by default) and report the bandwidth and profile
+	{
+		double start_time = wallTime();
+		int *perm = computeOrdering(&A, options.reorder);
+		double ordering_time = wallTime() - start_time;
+		start_time = wallTime();
+		CSRMatrix A_reordered = permuteSymmetric(&A, perm, options.num_threads); // P A P^T
+		double permute_time = wallTime() - start_time;
+
+		if (atoi(argv[3]) == 1)
+		{
+			printf("Matrix A:\n");
+			printMatrix(&A);
+			printf("\n");
+			printf("Reordered A:\n");
+			printMatrix(&A_reordered);
+			printf("\n");
+		}
+		reportReordering("A", &A, &A_reordered);
+		printf("Ordering time: %f seconds\n", ordering_time);
+		printf("Permutation time: %f seconds\n", permute_time);
+		printf("\n");
+
+		exportResult(&A_reordered, &options); // write P A P^T to the requested output files, if any
+
+		free(perm);
+		freeMatrix(&A);
+		freeMatrix(&A_reordered);
+		exit(EXIT_SUCCESS);
+	}
+	else if (argc == 4 && (strcmp(argv[2], "compress") == 0)) // compare plain CSR against CSR with compressed column indices
+	{
+		if (atoi(argv[3]) == 1)
+		{
+			printf("Matrix A:\n");
+			printMatrix(&A);
+			printf("\n");
+		}
+		benchCompressed(&A, &options);
+		freeMatrix(&A);
+		exit(EXIT_SUCCESS);
+	}
+	else if (argc == 4 && (strcmp(argv[2], "bsr") == 0)) // compare the BSR kernels against the CSR kernels
+	{
+		if (atoi(argv[3]) == 1)
+		{
+			printf("Matrix A:\n");
+			printMatrix(&A);
+			printf("\n");
+		}
+		benchBSR(&A, &options);
+		freeMatrix(&A);
+		exit(EXIT_SUCCESS);
+	}
+	else if (argc == 4 && (strcmp(argv[2], "extract") == 0)) // A(rows, cols) with the rows and columns given by --rows and --cols
+	{
+		CSRMatrix C = extractFromOptions(&A, &options);
+		if (options.sort_result)
+		{
+			ensureSorted(&C, options.num_threads); // sorting a view sorts the rows of A in place, which leaves A unchanged as a matrix
+		}
+		if (atoi(argv[3]) == 1)
+		{
+			printf("Matrix A:\n");
+			printMatrix(&A);
+			printf("\n");
+			printf("Submatrix:\n");
+			printMatrix(&C);
+			printf("\n");
+		}
+		exportResult(&C, &options);
+
+		freeMatrix(&C); // a view only frees its own row pointers, so A is still complete here
+		freeMatrix(&A);
+		exit(EXIT_SUCCESS);
+	}
+	else if (argc == 4 && (strcmp(argv[2], "solve") == 0)) // triangular solves with the lower (or --upper) triangle of A
+	{
+		if (atoi(argv[3]) == 1)
+		{
+			printf("Matrix A:\n");
+			printMatrix(&A);
+			printf("\n");
+		}
+		benchTriangular(&A, &options);
+		freeMatrix(&A);
+		exit(EXIT_SUCCESS);
+	}
+	else if (argc == 4 && (strcmp(argv[2], "numa") == 0)) // compare SpMV bandwidth per NUMA node with and without placement
+	{
+		if (atoi(argv[3]) == 1)
+		{
+			printf("Matrix A:\n");
+			printMatrix(&A);
+			printf("\n");
+		}
+		benchPlacement(&A, &options);
+		freeMatrix(&A);
+		exit(EXIT_SUCCESS);
+	}
+	else if (argc == 5 && (strcmp(argv[2], "power") == 0)) // ./main <file.mtx> power <k> <print>: A^k by repeated squaring
+	{
+		int k = atoi(argv[3]);
+		if (k < 0 || (k == 0 && strcmp(argv[3], "0") != 0))
+		{
+			fprintf(stderr, "Error: The exponent must be a non-negative integer.\n");
+			exit(EXIT_FAILURE);
+		}
+
+		ChainStats stats;
+		double start_time = wallTime();
+		CSRMatrix C = matrixPower(&A, k, options.drop_tolerance, &stats);
+		double compute_time = wallTime() - start_time;
+
+		if (options.sort_result)
+		{
+			ensureSorted(&C, options.num_threads);
+		}
+		if (atoi(argv[4]) == 1)
+		{
+			printf("Matrix A:\n");
+			printMatrix(&A);
+			printf("\n");
+			printf("A^%d:\n", k);
+			printMatrix(&C);
+			printf("\n");
+		}
+		printf("Result nnz: %d\n", C.num_non_zeros);
+		reportChain(&stats, compute_time);
+
+		exportResult(&C, &options);
+
+		freeMatrix(&A);
+		freeMatrix(&C);
+		exit(EXIT_SUCCESS);
+	}
 	else if (argc == 5) // handles cases where addition, subtraction or mutliplication need to be performed
 					    // checks whether the correct number of arguments have been passed for the other operations
 	{
-		const char *filename_2 = argv[2]; // file 2 is the second file
-		CSRMatrix B; // initialize matrix B
-		ReadMMtoCSR(filename_2, &B); // read file 2 and assign it matrix B
+		// matrix B was already loaded together with A
 		CSRMatrix C; // initialize resultant matrix C
 
 		const char *operation = argv[3]; // assigns the operation pointer to the 3rd passed argument which is the desired opertion
 
+		if (strcmp(operation, "estimate") == 0) // predict the cost and size of A * B without computing it
+		{
+			double start_time = wallTime();
+			ProductEstimate estimate = estimateProduct(&A, &B, options.sampled_rows, 12345u);
+			double estimate_time = wallTime() - start_time;
+
+			if (atoi(argv[4]) == 1)
+			{
+				printf("Matrix A:\n");
+				printMatrix(&A);
+				printf("\n");
+				printf("Matrix B:\n");
+				printMatrix(&B);
+				printf("\n");
+			}
+			printf("Multiply-adds of A * B: %lld (%lld FLOPs)\n", estimate.flops, 2 * estimate.flops);
+			printf("Upper bound on nnz(C): %lld (%.1f MB)\n", estimate.upper_bound, estimate.bytes_upper_bound / 1e6);
+			printf("Estimated nnz(C): %.0f +/- %.0f (95%% confidence, %d sampled rows, %.1f MB)\n", estimate.estimate,
+				   estimate.confidence_interval, estimate.sampled_rows, estimate.bytes_estimate / 1e6);
+			printf("Estimation time: %f seconds\n", estimate_time);
+			reportLoad(&load_report);
+			printf("\n");
+
+			freeLoadReport(&load_report);
+			freeMatrix(&A);
+			freeMatrix(&B);
+			exit(EXIT_SUCCESS);
+		}
+
+		/* With --reorder the operation is computed on P A P^T and P B P^T, which gives P C P^T for addition, subtraction and
+		multiplication, and the result is permuted back afterwards. The ordering is computed from A and applied to both matrices. */
+		const CSRMatrix *op_A = &A, *op_B = &B; // the matrices the operation is actually run on
+		CSRMatrix A_reordered, B_reordered;
+		int *perm = NULL;
+		double reorder_time = 0;
+
+		// a cached result is already in the original numbering, so a hit skips the reordering as well
+		unsigned long long cache_key = 0;
+		const CSRMatrix *inputs[2] = {&A, &B};
+		int cache_hit = cached_operation != NULL &&
+						cachedResult(&cache, cached_operation, argv + 1, inputs, 2, &options.load, options.num_threads, &cache_key, &C);
+		DistributedReport distributed_report = {0, NULL, 0.0, 0.0, 0.0}; // only filled in when the workers computed C
+
+		if (options.reorder != NULL && !cache_hit)
+		{
+			if (B.num_rows != A.num_rows || B.num_cols != A.num_cols)
+			{
+				fprintf(stderr, "Error: Reordering needs A and B to be square matrices of the same size.\n");
+				exit(EXIT_FAILURE);
+			}
+			double reorder_start = wallTime();
+			perm = computeOrdering(&A, options.reorder);
+			A_reordered = permuteSymmetric(&A, perm, options.num_threads);
+			B_reordered = permuteSymmetric(&B, perm, options.num_threads);
+			reorder_time = wallTime() - reorder_start;
+			reportReordering("A", &A, &A_reordered);
+			reportReordering("B", &B, &B_reordered);
+			op_A = &A_reordered;
+			op_B = &B_reordered;
+		}
+
 		// initlialize cpu time to check how long computation takes
 		clock_t start_time, end_time;
 		double cpu_time_used;
 		start_time = clock();
+		double compute_start = wallTime(); // wall time of the operation alone, next to the end-to-end time that includes loading
 
-			if (strcmp(operation, "addition") == 0) // checks if the operation to be performed is addition
+			if (cache_hit)
 			{
-				C = addition(&A, &B); // performs additon and assigns it to the resultant matrix C
+				// C was read from the cache
+			}
+			else if (strcmp(operation, "addition") == 0) // checks if the operation to be performed is addition
+			{
+				C = additionWithTolerance(op_A, op_B, options.drop_tolerance); // performs additon and assigns it to the resultant matrix C
 			} 
 			else if (strcmp(operation, "subtraction") == 0) // checks if the operation to be performed is subtraction
 			{
-				C = subtraction(&A, &B); // performs subtraction and assigns it to the resultant matrix C
+				C = subtractionWithTolerance(op_A, op_B, options.drop_tolerance); // performs subtraction and assigns it to the resultant matrix C
 			} 
+			else if (strcmp(operation, "multiplication") == 0 && options.num_workers > 0) // multiplication in worker processes, selected with --workers=<n>
+			{
+				C = multiplicationDistributed(op_A, op_B, options.drop_tolerance, options.num_workers, options.use_esc,
+												options.num_threads, &distributed_report);
+			}
+			else if (strcmp(operation, "multiplication") == 0 && options.use_esc) // multiplication with expand-sort-compress, selected with --spgemm=esc
+			{
+				C = multiplicationESC(op_A, op_B, options.drop_tolerance, options.num_threads);
+			}
 			else if (strcmp(operation, "multiplication") == 0) // checks if the operation to be performed is multiplication
 			{
-				C = multiplication(&A, &B); // performs multiplication and assigns it to the resultant matrix C
+				C = multiplicationWithTolerance(op_A, op_B, options.drop_tolerance); // performs multiplication and assigns it to the resultant matrix C
 			} 
+			else if (strcmp(operation, "hadamard") == 0) // element-wise product, only positions where both A and B have an entry
+			{
+				C = hadamardWithTolerance(op_A, op_B, options.drop_tolerance);
+			}
 			else // safe case for if a typo or something occured and prints the following error
 			{
-				fprintf(stderr, "Unsupported operation. Please use one of the following: addition, subtraction, multiplication, transpose.\n");
+				fprintf(stderr, "Unsupported operation. Please use one of the following: addition, subtraction, multiplication, hadamard, transpose, reorder, compress, bsr, estimate, power, chain, numa, extract, solve.\n");
 				freeMatrix(&A);
 				freeMatrix(&B);
 				exit(EXIT_FAILURE); // terminate program
@@ -112,6 +1218,31 @@ int main(int argc, char *argv[])
 			// end cpu timer 
 			end_time = clock();
 			cpu_time_used = ((double)(end_time - start_time)) / CLOCKS_PER_SEC;
+			double compute_wall_time = wallTime() - compute_start;
+
+			if (perm != NULL) // move the result from the permuted space back to the original numbering
+			{
+				double reorder_start = wallTime();
+				CSRMatrix C_reordered = C;
+				C = unpermuteSymmetric(&C_reordered, perm, options.num_threads);
+				reorder_time += wallTime() - reorder_start;
+				freeMatrix(&C_reordered);
+				freeMatrix(&A_reordered);
+				freeMatrix(&B_reordered);
+				free(perm);
+				printf("Reordering time: %f seconds\n", reorder_time);
+				printf("\n");
+			}
+
+			if (cached_operation != NULL && !cache_hit)
+			{
+				storeResult(&cache, cache_key, &C); // stored before --sort so the cache holds what the kernel produced
+			}
+
+			if (options.sort_result)
+			{
+				ensureSorted(&C, options.num_threads); // multiplication leaves its rows unsorted, addition and subtraction of sorted inputs are already sorted
+			}
 
 			// Lastly we need to check if the print option was indicated to be 1 and print the matrices if yes, otherwise just print cpu time.
 			if (atoi(argv[4]) == 1) 
@@ -133,9 +1264,25 @@ int main(int argc, char *argv[])
 				printf("CPU time: %f seconds\n", cpu_time_used); 
 				printf("\n");
 			}
-			
+
+			reportLoad(&load_report);
+			if (distributed_report.num_workers > 0)
+			{
+				reportDistributed(&distributed_report);
+				freeDistributedReport(&distributed_report);
+			}
+			if (cached_operation != NULL)
+			{
+				reportCache(&cache);
+				closeResultCache(&cache);
+			}
+			printf("Compute wall time: %f seconds, end-to-end wall time: %f seconds\n", compute_wall_time, wallTime() - program_start);
+			printf("\n");
+
+			exportResult(&C, &options); // write C to the requested output files, if any
 
 			// We need to make sure to free the allocated memory for matrices A,B, and C
+			freeLoadReport(&load_report);
 			freeMatrix(&A);
 			freeMatrix(&B);
 			freeMatrix(&C);
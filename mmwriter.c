@@ -0,0 +1,317 @@
+#include <stdio.h>      // the standard c library
+#include "mmwriter.h"   // reference the header file with the writer declarations
+#include <stdlib.h>     // provides memory allocation functions
+#include <string.h>     // provides string based functions like memcpy() and memcmp()
+#include <math.h>       // provides isfinite()
+
+#define WRITER_CHUNK_NNZ 65536      // roughly how many entries are formatted into one buffer before it is handed to fwrite()
+#define WRITER_MAX_ENTRY_CHARS 48   // upper bound on the characters of one "row col value\n" line: 10 + 1 + 10 + 1 + 24 + 1
+
+// Table of all two digit pairs "00" to "99", this lets the integer formatter produce two digits per division instead of one
+static const char digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839404142434445464748495051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+// Powers of ten which are exactly representable as doubles, used by the decimal fast path in formatDouble()
+static const double powers_of_ten[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+
+// Writes the decimal digits of value to out (no terminator) and returns the position right after the last digit
+static char *formatUnsigned(char *out, unsigned long long value)
+{
+    char digits[20]; // 2^64 has 20 decimal digits
+    int position = 20;
+
+    while (value >= 100) // peel off two digits at a time from the right
+    {
+        unsigned int pair = (unsigned int)(value % 100) * 2;
+        value /= 100;
+        digits[--position] = digit_pairs[pair + 1];
+        digits[--position] = digit_pairs[pair];
+    }
+    if (value >= 10)
+    {
+        unsigned int pair = (unsigned int)value * 2;
+        digits[--position] = digit_pairs[pair + 1];
+        digits[--position] = digit_pairs[pair];
+    }
+    else
+    {
+        digits[--position] = (char)('0' + value);
+    }
+
+    memcpy(out, digits + position, 20 - position);
+    return out + (20 - position);
+}
+
+/* Writes value to out and returns the position right after the last character. Most values in the bundled matrices
+are integers or short decimals (0.45, -0.0176, ...), so before falling back to snprintf("%.17g") we look for the smallest
+k <= 9 such that value == r / 10^k for an integer r. Because r and 10^k are both exact doubles the division is correctly
+rounded, so printing r with k decimals is guaranteed to read back to exactly the same double. */
+static char *formatDouble(char *out, double value)
+{
+    if (value == 0)
+    {
+        *out++ = '0';
+        return out;
+    }
+    if (!isfinite(value))
+    {
+        return out + snprintf(out, WRITER_MAX_ENTRY_CHARS, "%.17g", value);
+    }
+
+    if (value < 0) // handle the sign once so the rest of the function only deals with positive values
+    {
+        *out++ = '-';
+        value = -value;
+    }
+
+    if (value < 1e15)
+    {
+        for (int k = 0; k < (int)(sizeof(powers_of_ten) / sizeof(powers_of_ten[0])); k++)
+        {
+            double scaled = value * powers_of_ten[k];
+            if (scaled >= 9e15) // r would no longer be an exact integer in a double
+            {
+                break;
+            }
+
+            unsigned long long r = (unsigned long long)(scaled + 0.5); // round to the nearest integer
+            if ((double)r / powers_of_ten[k] != value)
+            {
+                continue; // value needs more decimals than k
+            }
+
+            if (k == 0)
+            {
+                return formatUnsigned(out, r);
+            }
+
+            // print r and then move the last k digits behind a decimal point, padding with leading zeros where needed
+            char digits[24];
+            int length = (int)(formatUnsigned(digits, r) - digits);
+            if (length <= k)
+            {
+                *out++ = '0';
+                *out++ = '.';
+                for (int z = length; z < k; z++)
+                {
+                    *out++ = '0';
+                }
+                memcpy(out, digits, length);
+                return out + length;
+            }
+            memcpy(out, digits, length - k);
+            out += length - k;
+            *out++ = '.';
+            memcpy(out, digits + length - k, k);
+            return out + k;
+        }
+    }
+
+    return out + snprintf(out, WRITER_MAX_ENTRY_CHARS, "%.17g", value); // general case, 17 significant digits always round trip
+}
+
+// Formats the entries of rows [first_row, last_row) as Matrix Market lines into buffer and returns the number of characters written
+static size_t formatRows(const CSRMatrix *matrix, int first_row, int last_row, char *buffer)
+{
+    char *out = buffer;
+    for (int i = first_row; i < last_row; i++)
+    {
+        for (int j = matrix->row_ptr[i]; j < matrix->row_ptr[i + 1]; j++)
+        {
+            out = formatUnsigned(out, (unsigned long long)i + 1); // Matrix Market uses 1-based indexing so we convert back from the 0-based indices
+            *out++ = ' ';
+            out = formatUnsigned(out, (unsigned long long)matrix->col_ind[j] + 1);
+            *out++ = ' ';
+            out = formatDouble(out, matrix->csr_data[j]);
+            *out++ = '\n';
+        }
+    }
+    return (size_t)(out - buffer);
+}
+
+void writeMMfromCSR(const char *filename, const CSRMatrix *matrix, int num_threads)
+{
+    FILE *file = fopen(filename, "wb"); // open the output file in (binary) write mode so no newline translation happens
+    if (file == NULL)
+    {
+        fprintf(stderr, "Error: Failed to open %s for writing\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    fprintf(file, "%%%%MatrixMarket matrix coordinate real general\n");                     // Matrix Market banner
+    fprintf(file, "%d %d %d\n", matrix->num_rows, matrix->num_cols, matrix->num_non_zeros); // size line
+
+    if (num_threads < 1)
+    {
+        num_threads = 1;
+    }
+
+    /* The rows are cut into chunks of about WRITER_CHUNK_NNZ entries. A batch of chunks is formatted at the same time (one
+    buffer per chunk, in parallel when more than one thread is used) and the buffers are then written to the file in order,
+    so the output is identical no matter how many threads are used and memory stays bounded for very large matrices. */
+    int batch_size = 2 * num_threads;
+    char **buffers = (char **)calloc(batch_size, sizeof(char *));
+    size_t *capacities = (size_t *)calloc(batch_size, sizeof(size_t));
+    size_t *lengths = (size_t *)malloc(batch_size * sizeof(size_t));
+    int *chunk_start = (int *)malloc((batch_size + 1) * sizeof(int));
+    if (buffers == NULL || capacities == NULL || lengths == NULL || chunk_start == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for the writer buffers.\n");
+        free(buffers);
+        free(capacities);
+        free(lengths);
+        free(chunk_start);
+        fclose(file);
+        exit(EXIT_FAILURE);
+    }
+
+    int row = 0;
+    while (row < matrix->num_rows)
+    {
+        // find the chunk boundaries for this batch
+        int num_chunks = 0;
+        while (num_chunks < batch_size && row < matrix->num_rows)
+        {
+            chunk_start[num_chunks++] = row;
+            int limit = matrix->row_ptr[row] + WRITER_CHUNK_NNZ;
+            do
+            {
+                row++;
+            } while (row < matrix->num_rows && matrix->row_ptr[row + 1] <= limit);
+        }
+        chunk_start[num_chunks] = row;
+
+        // make sure every buffer is big enough for the worst case length of its chunk
+        for (int c = 0; c < num_chunks; c++)
+        {
+            size_t needed = (size_t)(matrix->row_ptr[chunk_start[c + 1]] - matrix->row_ptr[chunk_start[c]]) * WRITER_MAX_ENTRY_CHARS + 1;
+            if (needed > capacities[c])
+            {
+                char *grown = (char *)realloc(buffers[c], needed);
+                if (grown == NULL)
+                {
+                    fprintf(stderr, "Error: Memory allocation failed for the writer buffers.\n");
+                    for (int b = 0; b < batch_size; b++)
+                    {
+                        free(buffers[b]);
+                    }
+                    free(buffers);
+                    free(capacities);
+                    free(lengths);
+                    free(chunk_start);
+                    fclose(file);
+                    exit(EXIT_FAILURE);
+                }
+                buffers[c] = grown;
+                capacities[c] = needed;
+            }
+        }
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+        for (int c = 0; c < num_chunks; c++)
+        {
+            lengths[c] = formatRows(matrix, chunk_start[c], chunk_start[c + 1], buffers[c]);
+        }
+
+        for (int c = 0; c < num_chunks; c++) // the chunks are written in row order
+        {
+            if (fwrite(buffers[c], 1, lengths[c], file) != lengths[c])
+            {
+                fprintf(stderr, "Error: Failed to write to %s\n", filename);
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+
+    for (int b = 0; b < batch_size; b++) // free up the temporary buffers
+    {
+        free(buffers[b]);
+    }
+    free(buffers);
+    free(capacities);
+    free(lengths);
+    free(chunk_start);
+
+    if (fclose(file) != 0) // fclose flushes the remaining data so a full disk is only reported here
+    {
+        fprintf(stderr, "Error: Failed to write to %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+}
+
+void writeCSRArrays(const char *filename, const CSRMatrix *matrix)
+{
+    FILE *file = fopen(filename, "wb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Error: Failed to open %s for writing\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    // header: magic followed by the three dimensions, then the arrays exactly as they are stored in memory
+    int dimensions[3] = {matrix->num_rows, matrix->num_cols, matrix->num_non_zeros};
+    size_t nnz = (size_t)matrix->num_non_zeros;
+    if (fwrite(CSR_ARRAYS_MAGIC, 1, 4, file) != 4 ||
+        fwrite(dimensions, sizeof(int), 3, file) != 3 ||
+        fwrite(matrix->row_ptr, sizeof(int), matrix->num_rows + 1, file) != (size_t)matrix->num_rows + 1 ||
+        fwrite(matrix->col_ind, sizeof(int), nnz, file) != nnz ||
+        fwrite(matrix->csr_data, sizeof(double), nnz, file) != nnz ||
+        fclose(file) != 0)
+    {
+        fprintf(stderr, "Error: Failed to write to %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+}
+
+void ReadCSRArrays(const char *filename, CSRMatrix *matrix)
+{
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Error: Failed to open %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    char magic[4];
+    int dimensions[3];
+    if (fread(magic, 1, 4, file) != 4 || memcmp(magic, CSR_ARRAYS_MAGIC, 4) != 0 ||
+        fread(dimensions, sizeof(int), 3, file) != 3 || dimensions[0] < 0 || dimensions[1] < 0 || dimensions[2] < 0)
+    {
+        fprintf(stderr, "Error: %s is not a CSR array file\n", filename);
+        fclose(file);
+        exit(EXIT_FAILURE);
+    }
+
+    matrix->num_rows = dimensions[0];
+    matrix->num_cols = dimensions[1];
+    matrix->num_non_zeros = dimensions[2];
+    size_t nnz = (size_t)matrix->num_non_zeros;
+
+    matrix->row_ptr = (int *)malloc((matrix->num_rows + 1) * sizeof(int));
+    matrix->col_ind = (int *)malloc(nnz * sizeof(int));
+    matrix->csr_data = (double *)malloc(nnz * sizeof(double));
+    if (matrix->row_ptr == NULL || matrix->col_ind == NULL || matrix->csr_data == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed while reading %s\n", filename);
+        free(matrix->row_ptr);
+        free(matrix->col_ind);
+        free(matrix->csr_data);
+        fclose(file);
+        exit(EXIT_FAILURE);
+    }
+
+    if (fread(matrix->row_ptr, sizeof(int), matrix->num_rows + 1, file) != (size_t)matrix->num_rows + 1 ||
+        fread(matrix->col_ind, sizeof(int), nnz, file) != nnz ||
+        fread(matrix->csr_data, sizeof(double), nnz, file) != nnz)
+    {
+        fprintf(stderr, "Error: %s is truncated\n", filename);
+        freeMatrix(matrix);
+        fclose(file);
+        exit(EXIT_FAILURE);
+    }
+
+    fclose(file);
+
+    matrix->sorted = rowsAreSorted(matrix); // the sorted flag is not stored in the file so it is recomputed
+    matrix->owns_data = 1;
+}
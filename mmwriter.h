@@ -0,0 +1,16 @@
+#ifndef MMWRITER_H
+#define MMWRITER_H
+
+#include "functions.h" // needed for the CSRMatrix struct
+
+#define CSR_ARRAYS_MAGIC "CSR1" // first four bytes of every file written by writeCSRArrays()
+
+/* Writers used to export a CSR matrix to a file instead of printing it with printMatrix().
+Both writers format into large memory buffers and hand them to fwrite() in big blocks, so the cost
+is dominated by number formatting rather than by one stdio call per element. */
+
+void writeMMfromCSR(const char *filename, const CSRMatrix *matrix, int num_threads); // writes a valid Matrix Market "coordinate real general" file, formatting is split over num_threads threads
+void writeCSRArrays(const char *filename, const CSRMatrix *matrix);                  // writes the raw CSR arrays in a binary layout (header + row_ptr + col_ind + csr_data)
+void ReadCSRArrays(const char *filename, CSRMatrix *matrix);                         // reads a file written by writeCSRArrays() back into a CSR matrix
+
+#endif
@@ -0,0 +1,43 @@
+#include <stdio.h>     // the standard c library
+#include "pipeline.h"  // reference the header file with the pipelined loader declarations
+#include <stdlib.h>    // provides free()
+
+void loadOperands(const char *filename_A, const char *filename_B, CSRMatrix *A, CSRMatrix *B, const LoadOptions *options, LoadReport *report)
+{
+    double start_time = wallTime();
+    report->symbolic_time = 0.0;
+
+    /* Parsing is the slow part of a binary operation and the two files do not depend on each other, so they are read by two
+    threads at the same time. The thread that reads A goes on with the work that only needs A (row statistics and the column
+    counts that the flop count of A * B needs) while the other thread is still parsing B. Only the last step, combining the
+    column counts of A with the row lengths of B, has to wait for both. */
+#pragma omp parallel sections num_threads(2)
+    {
+#pragma omp section
+        {
+            double load_start = wallTime();
+            ReadMMtoCSRWithOptions(filename_A, A, options);
+            double symbolic_start = wallTime();
+            report->load_time_A = symbolic_start - load_start;
+            report->rows_A = rowStatistics(A);
+            report->column_counts_A = columnCounts(A);
+            report->symbolic_time = wallTime() - symbolic_start;
+        }
+#pragma omp section
+        {
+            double load_start = wallTime();
+            ReadMMtoCSRWithOptions(filename_B, B, options);
+            report->load_time_B = wallTime() - load_start;
+            report->rows_B = rowStatistics(B);
+        }
+    }
+
+    report->flops = A->num_cols == B->num_rows ? flopsFromColumnCounts(report->column_counts_A, A->num_cols, B) : -1;
+    report->wall_time = wallTime() - start_time;
+}
+
+void freeLoadReport(LoadReport *report)
+{
+    free(report->column_counts_A);
+    report->column_counts_A = NULL;
+}
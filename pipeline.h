@@ -0,0 +1,22 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "functions.h" // needed for the CSRMatrix and LoadOptions structs
+#include "estimate.h"  // needed for the RowStatistics struct
+
+// What happened while the two operands of a binary operation were loaded
+typedef struct {
+    double load_time_A;        // wall time spent parsing the file of A
+    double load_time_B;        // wall time spent parsing the file of B
+    double symbolic_time;      // wall time of the work on A that ran while B was still being parsed
+    double wall_time;          // wall time of the whole loading stage
+    RowStatistics rows_A;      // row statistics of A
+    RowStatistics rows_B;      // row statistics of B
+    int *column_counts_A;      // non-zeros in every column of A, used for the flop count
+    long long flops;           // multiply-adds of A * B, -1 when the inner dimensions do not match
+} LoadReport;
+
+void loadOperands(const char *filename_A, const char *filename_B, CSRMatrix *A, CSRMatrix *B, const LoadOptions *options, LoadReport *report); // loads A and B on two threads and analyses A while B is still loading
+void freeLoadReport(LoadReport *report); // frees the column counts of the report
+
+#endif
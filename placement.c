@@ -0,0 +1,315 @@
+#define _GNU_SOURCE    // needed for sched_getcpu()
+#include <stdio.h>     // the standard c library
+#include "placement.h" // reference the header file with the NUMA placement declarations
+#include <stdlib.h>    // provides memory allocation functions
+#include <string.h>    // provides memcpy() and memset()
+#include <unistd.h>    // provides syscall() and sysconf()
+#include <sched.h>     // provides sched_getcpu()
+#include <sys/syscall.h> // provides the SYS_mbind and SYS_move_pages numbers
+
+#define MAX_CPUS 4096               // cpus that are mapped to a node, higher cpus count as node 0
+#define MAX_QUERIED_PAGES 65536     // pagesPerNode() looks at evenly spaced pages when an array has more pages than this
+#define INTERLEAVE_MODE 3           // MPOL_INTERLEAVE of the kernel, defined here so libnuma is not needed
+
+/* The topology is read from sysfs and the placement is done with the mbind and move_pages system calls directly, so the
+calculator builds and runs without libnuma. When sysfs has no node information every cpu counts as node 0 and the machine
+is treated as a single node, which turns placement off. */
+static int node_count = 0;           // 0 until readTopology() ran
+static unsigned long node_mask = 0;  // bit n is set when node n is online
+static short cpu_node[MAX_CPUS];     // node of every cpu
+
+// Expands a sysfs list like "0-3,8,10-11" into values, returns how many were stored
+static int parseList(const char *text, int *values, int max_values)
+{
+    int count = 0;
+    while (*text != '\0' && *text != '\n')
+    {
+        char *end;
+        long first = strtol(text, &end, 10);
+        if (end == text)
+        {
+            break;
+        }
+        long last = first;
+        text = end;
+        if (*text == '-')
+        {
+            last = strtol(text + 1, &end, 10);
+            text = end;
+        }
+        for (long value = first; value <= last && count < max_values; value++)
+        {
+            values[count++] = (int)value;
+        }
+        if (*text == ',')
+        {
+            text++;
+        }
+    }
+    return count;
+}
+
+// Reads one line of a sysfs file, returns 0 when the file does not exist
+static int readLine(const char *path, char *line, int size)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        return 0;
+    }
+    int ok = fgets(line, size, file) != NULL;
+    fclose(file);
+    return ok;
+}
+
+static void readTopology(void)
+{
+    if (node_count > 0)
+    {
+        return;
+    }
+    node_count = 1;
+    node_mask = 1;
+    memset(cpu_node, 0, sizeof(cpu_node));
+
+    char line[4096];
+    int *values = (int *)malloc(MAX_CPUS * sizeof(int));
+    if (values == NULL || !readLine("/sys/devices/system/node/online", line, sizeof(line)))
+    {
+        free(values);
+        return; // no NUMA information, one node
+    }
+
+    int nodes = parseList(line, values, PLACEMENT_MAX_NODES);
+    int *online = (int *)malloc((nodes > 0 ? nodes : 1) * sizeof(int));
+    if (online == NULL)
+    {
+        free(values);
+        return;
+    }
+    memcpy(online, values, nodes * sizeof(int));
+
+    node_mask = 0;
+    for (int n = 0; n < nodes; n++)
+    {
+        if (online[n] >= PLACEMENT_MAX_NODES)
+        {
+            continue;
+        }
+        node_mask |= 1UL << online[n];
+        if (online[n] + 1 > node_count)
+        {
+            node_count = online[n] + 1;
+        }
+
+        char path[128];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", online[n]);
+        if (readLine(path, line, sizeof(line)))
+        {
+            int cpus = parseList(line, values, MAX_CPUS);
+            for (int c = 0; c < cpus; c++)
+            {
+                if (values[c] < MAX_CPUS)
+                {
+                    cpu_node[values[c]] = (short)online[n];
+                }
+            }
+        }
+    }
+    if (node_mask == 0)
+    {
+        node_mask = 1;
+    }
+    free(online);
+    free(values);
+}
+
+int numaNodeCount(void)
+{
+    readTopology();
+    return node_count;
+}
+
+int numaNodeOfCpu(int cpu)
+{
+    readTopology();
+    return cpu >= 0 && cpu < MAX_CPUS ? cpu_node[cpu] : 0;
+}
+
+void *allocatePlaced(size_t bytes, PlacementPolicy policy)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t rounded = ((bytes > 0 ? bytes : 1) + page - 1) / page * page; // whole pages, so the policy never touches a neighbour
+    void *data = NULL;
+    if (posix_memalign(&data, page, rounded) != 0)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for a placed array.\n");
+        exit(EXIT_FAILURE);
+    }
+
+#ifdef SYS_mbind
+    if (policy == PLACEMENT_INTERLEAVE && numaNodeCount() > 1)
+    {
+        /* The policy only applies to pages that are not touched yet, which is the case for fresh memory. When the kernel
+        refuses (no NUMA support or no permission) the pages simply fall back to first touch. */
+        syscall(SYS_mbind, data, rounded, INTERLEAVE_MODE, &node_mask, (unsigned long)PLACEMENT_MAX_NODES + 1, 0);
+    }
+#else
+    (void)policy;
+#endif
+    return data;
+}
+
+void placeMatrix(CSRMatrix *A, PlacementPolicy policy, int num_threads)
+{
+    if (policy == PLACEMENT_OFF || numaNodeCount() < 2 || !A->owns_data) // with one node every page is already local, views keep the pages of their parent
+    {
+        return;
+    }
+    if (num_threads < 1)
+    {
+        num_threads = 1;
+    }
+
+    int *row_ptr = (int *)allocatePlaced((A->num_rows + 1) * sizeof(int), policy);
+    int *col_ind = (int *)allocatePlaced((size_t)A->num_non_zeros * sizeof(int), policy);
+    double *csr_data = (double *)allocatePlaced((size_t)A->num_non_zeros * sizeof(double), policy);
+
+    /* The copy is the first write to the new arrays, and it uses the static row partition of spmv(), so every row is
+    touched by the same thread that computes it later. */
+#pragma omp parallel for schedule(static) num_threads(num_threads)
+    for (int i = 0; i < A->num_rows; i++)
+    {
+        int start = A->row_ptr[i];
+        int length = A->row_ptr[i + 1] - start;
+        row_ptr[i] = start;
+        memcpy(col_ind + start, A->col_ind + start, length * sizeof(int));
+        memcpy(csr_data + start, A->csr_data + start, length * sizeof(double));
+    }
+    row_ptr[A->num_rows] = A->row_ptr[A->num_rows];
+
+    free(A->row_ptr);
+    free(A->col_ind);
+    free(A->csr_data);
+    A->row_ptr = row_ptr;
+    A->col_ind = col_ind;
+    A->csr_data = csr_data;
+}
+
+double *allocatePlacedVector(int length, PlacementPolicy policy, int num_threads)
+{
+    double *vector = (double *)allocatePlaced((size_t)length * sizeof(double), policy);
+    if (num_threads < 1)
+    {
+        num_threads = 1;
+    }
+#pragma omp parallel for schedule(static) num_threads(num_threads)
+    for (int i = 0; i < length; i++)
+    {
+        vector[i] = 0.0;
+    }
+    return vector;
+}
+
+int pagesPerNode(const void *data, size_t bytes, long long *pages)
+{
+    memset(pages, 0, PLACEMENT_MAX_NODES * sizeof(long long));
+#ifdef SYS_move_pages
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    char *first = (char *)((size_t)data / page * page);
+    size_t total = ((size_t)data + bytes - (size_t)first + page - 1) / page;
+    if (total == 0)
+    {
+        return 1;
+    }
+    size_t stride = (total + MAX_QUERIED_PAGES - 1) / MAX_QUERIED_PAGES;
+    size_t count = (total + stride - 1) / stride;
+
+    void **addresses = (void **)malloc(count * sizeof(void *));
+    int *status = (int *)malloc(count * sizeof(int));
+    if (addresses == NULL || status == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for the page query.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t p = 0; p < count; p++)
+    {
+        addresses[p] = first + p * stride * page;
+    }
+
+    // move_pages without target nodes does not move anything, it only reports the node of every page
+    int ok = syscall(SYS_move_pages, 0, (unsigned long)count, addresses, NULL, status, 0) == 0;
+    if (ok)
+    {
+        for (size_t p = 0; p < count; p++)
+        {
+            if (status[p] >= 0 && status[p] < PLACEMENT_MAX_NODES) // negative means the page is not mapped yet
+            {
+                pages[status[p]] += (long long)stride;
+            }
+        }
+    }
+    free(addresses);
+    free(status);
+    return ok;
+#else
+    (void)data;
+    (void)bytes;
+    return 0;
+#endif
+}
+
+void spmvNodeBandwidth(const CSRMatrix *A, const double *x, double *y, int num_threads, int repetitions, NodeBandwidth *result)
+{
+    memset(result, 0, sizeof(*result));
+    if (num_threads < 1)
+    {
+        num_threads = 1;
+    }
+    if (repetitions < 1)
+    {
+        repetitions = 1;
+    }
+
+#pragma omp parallel num_threads(num_threads)
+    {
+        double bytes = 0.0, seconds = 0.0;
+        for (int r = 0; r < repetitions; r++)
+        {
+#pragma omp barrier
+            // same loop and schedule as spmv(), so each thread works on the rows its pages were placed for
+            double start_time = wallTime();
+#pragma omp for schedule(static) nowait
+            for (int i = 0; i < A->num_rows; i++)
+            {
+                double sum = 0.0;
+                for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++)
+                {
+                    sum += A->csr_data[j] * x[A->col_ind[j]];
+                }
+                y[i] = sum;
+                if (r == 0) // traffic of the row: values, column indices and x entries, its row pointer and y
+                {
+                    bytes += (A->row_ptr[i + 1] - A->row_ptr[i]) * (2.0 * sizeof(double) + sizeof(int)) + sizeof(int) + sizeof(double);
+                }
+            }
+            seconds += wallTime() - start_time;
+        }
+        seconds /= repetitions;
+
+        int node = numaNodeOfCpu(sched_getcpu()); // threads are not pinned, so this is where the thread ran at the end
+        if (node >= PLACEMENT_MAX_NODES)
+        {
+            node = 0;
+        }
+#pragma omp critical
+        {
+            result->threads[node]++;
+            result->bytes[node] += bytes;
+            if (seconds > result->seconds[node])
+            {
+                result->seconds[node] = seconds;
+            }
+        }
+    }
+}
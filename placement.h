@@ -0,0 +1,31 @@
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+#include <stddef.h>    // provides size_t
+#include "functions.h" // needed for the CSRMatrix struct
+
+#define PLACEMENT_MAX_NODES 64 // NUMA nodes that are tracked, enough for one unsigned long node mask
+
+// Where the pages of the CSR arrays should end up
+typedef enum {
+    PLACEMENT_OFF,          // leave the arrays wherever the loader and the kernels put them
+    PLACEMENT_FIRST_TOUCH,  // every thread touches the rows it computes first, so their pages land on its own node
+    PLACEMENT_INTERLEAVE    // spread the pages round robin over all nodes
+} PlacementPolicy;
+
+// SpMV traffic and time of the threads that ran on each NUMA node
+typedef struct {
+    int threads[PLACEMENT_MAX_NODES];    // threads that ran on the node
+    double bytes[PLACEMENT_MAX_NODES];   // bytes those threads moved in one SpMV
+    double seconds[PLACEMENT_MAX_NODES]; // time of the slowest of those threads for one SpMV
+} NodeBandwidth;
+
+int numaNodeCount(void); // number of NUMA nodes of the machine, 1 when the machine has no NUMA information
+int numaNodeOfCpu(int cpu); // node a cpu belongs to
+void *allocatePlaced(size_t bytes, PlacementPolicy policy); // page aligned memory that can be freed with free(), interleaved when asked for
+void placeMatrix(CSRMatrix *A, PlacementPolicy policy, int num_threads); // moves the arrays of A to memory first touched with the row partition of the kernels
+double *allocatePlacedVector(int length, PlacementPolicy policy, int num_threads); // zeroed vector first touched with the same row partition
+int pagesPerNode(const void *data, size_t bytes, long long *pages); // counts the pages of data on every node, returns 0 when the kernel can not tell
+void spmvNodeBandwidth(const CSRMatrix *A, const double *x, double *y, int num_threads, int repetitions, NodeBandwidth *result); // spmv() timed per thread and grouped by node
+
+#endif
@@ -0,0 +1,382 @@
+#include <stdio.h>     // the standard c library
+#include "reorder.h"   // reference the header file with the reordering declarations
+#include <stdlib.h>    // provides memory allocation functions and qsort()
+#include <string.h>    // provides memset()
+
+#define INSERTION_SORT_SEGMENT_LENGTH 16 // neighbour lists up to this length are sorted by degree with insertion sort, longer ones with qsort
+
+/* Builds the adjacency lists of the undirected graph of A: node i is connected to node j when A(i, j) or A(j, i) is non-zero
+and i != j. The pattern of A + A^T is needed because Cuthill-McKee is defined for symmetric matrices, and the values are not
+used at all (adding the values could make entries cancel out). Duplicates are skipped with the same column marker idea as in addition(). */
+static void buildSymmetricPattern(const CSRMatrix *A, int **ptr_out, int **adj_out)
+{
+    int n = A->num_rows;
+    CSRMatrix A_transpose = transpose(A);
+
+    int *ptr = (int *)allocateOrExit((n + 1) * sizeof(int), "the pattern row pointers");
+    int *adj = (int *)allocateOrExit(2 * (size_t)A->num_non_zeros * sizeof(int), "the pattern adjacency"); // worst case: A and A^T share no entries
+    int *marker = (int *)allocateOrExit(n * sizeof(int), "the pattern marker");
+    memset(marker, -1, n * sizeof(int));
+
+    int count = 0;
+    for (int i = 0; i < n; i++)
+    {
+        ptr[i] = count;
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++) // neighbours from row i of A
+        {
+            int col = A->col_ind[j];
+            if (col != i && marker[col] != i)
+            {
+                marker[col] = i; // marker[col] == i means col is already in the list of node i
+                adj[count++] = col;
+            }
+        }
+        for (int j = A_transpose.row_ptr[i]; j < A_transpose.row_ptr[i + 1]; j++) // neighbours from column i of A
+        {
+            int col = A_transpose.col_ind[j];
+            if (col != i && marker[col] != i)
+            {
+                marker[col] = i;
+                adj[count++] = col;
+            }
+        }
+    }
+    ptr[n] = count;
+
+    free(marker);
+    freeMatrix(&A_transpose);
+    *ptr_out = ptr;
+    *adj_out = adj;
+}
+
+// Returns the nodes 0..n-1 ordered by increasing key using a counting sort (stable, so ties keep their original order)
+static int *countingSortByKey(const int *key, int n, int max_key)
+{
+    int *count = (int *)calloc(max_key + 2, sizeof(int));
+    int *order = (int *)allocateOrExit(n * sizeof(int), "the ordering");
+    if (count == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for the counting sort.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < n; i++) // count how often every key appears
+    {
+        count[key[i] + 1]++;
+    }
+    for (int k = 1; k <= max_key + 1; k++) // turn the counts into start positions
+    {
+        count[k] += count[k - 1];
+    }
+    for (int i = 0; i < n; i++) // place every node at the next free position of its key
+    {
+        order[count[key[i]]++] = i;
+    }
+
+    free(count);
+    return order;
+}
+
+static int compareLongLong(const void *a, const void *b)
+{
+    long long x = *(const long long *)a;
+    long long y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+// Sorts a list of nodes by increasing degree, ties are broken by the node number so the result does not depend on the sort used
+static void sortByDegree(int *nodes, int length, const int *degree)
+{
+    if (length <= INSERTION_SORT_SEGMENT_LENGTH)
+    {
+        for (int j = 1; j < length; j++)
+        {
+            int node = nodes[j];
+            int k = j - 1;
+            while (k >= 0 && (degree[nodes[k]] > degree[node] || (degree[nodes[k]] == degree[node] && nodes[k] > node)))
+            {
+                nodes[k + 1] = nodes[k];
+                k--;
+            }
+            nodes[k + 1] = node;
+        }
+        return;
+    }
+
+    // long lists (e.g. the centre of a star) are sorted through (degree, node) keys so the sort stays O(length log length)
+    long long *keys = (long long *)allocateOrExit(length * sizeof(long long), "the degree keys");
+    for (int j = 0; j < length; j++)
+    {
+        keys[j] = ((long long)degree[nodes[j]] << 32) | (unsigned int)nodes[j];
+    }
+    qsort(keys, length, sizeof(long long), compareLongLong);
+    for (int j = 0; j < length; j++)
+    {
+        nodes[j] = (int)(keys[j] & 0xffffffffLL);
+    }
+    free(keys);
+}
+
+/* Breadth first search from root over the graph. Returns the depth of the level structure (the eccentricity of root) and
+stores in *candidate the node of smallest degree in the deepest level. level must be -1 for every node on entry and is reset
+before returning, queue needs room for the whole connected component of root. */
+static int bfsLevelStructure(const int *ptr, const int *adj, const int *degree, int root, int *level, int *queue, int *candidate)
+{
+    int head = 0, tail = 0;
+    queue[tail++] = root;
+    level[root] = 0;
+    while (head < tail)
+    {
+        int node = queue[head++];
+        for (int j = ptr[node]; j < ptr[node + 1]; j++)
+        {
+            if (level[adj[j]] == -1)
+            {
+                level[adj[j]] = level[node] + 1;
+                queue[tail++] = adj[j];
+            }
+        }
+    }
+
+    int depth = level[queue[tail - 1]]; // the last node reached is in the deepest level
+    *candidate = queue[tail - 1];
+    for (int k = tail - 1; k >= 0 && level[queue[k]] == depth; k--)
+    {
+        if (degree[queue[k]] < degree[*candidate])
+        {
+            *candidate = queue[k];
+        }
+    }
+
+    for (int k = 0; k < tail; k++) // reset the levels for the next search
+    {
+        level[queue[k]] = -1;
+    }
+    return depth;
+}
+
+/* George-Liu heuristic for a pseudo-peripheral node: keep jumping to a low degree node of the deepest level while that makes the
+level structure deeper. Starting Cuthill-McKee from such a node gives long, thin level structures and therefore a small bandwidth. */
+static int pseudoPeripheralNode(const int *ptr, const int *adj, const int *degree, int root, int *level, int *queue)
+{
+    int candidate;
+    int eccentricity = bfsLevelStructure(ptr, adj, degree, root, level, queue, &candidate);
+    while (candidate != root)
+    {
+        int next_candidate;
+        int depth = bfsLevelStructure(ptr, adj, degree, candidate, level, queue, &next_candidate);
+        if (depth <= eccentricity)
+        {
+            break; // the level structure stopped getting deeper
+        }
+        root = candidate;
+        eccentricity = depth;
+        candidate = next_candidate;
+    }
+    return root;
+}
+
+int *reverseCuthillMcKee(const CSRMatrix *A)
+{
+    if (A->num_rows != A->num_cols)
+    {
+        fprintf(stderr, "Error: Reverse Cuthill-McKee needs a square matrix.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    int n = A->num_rows;
+    int *ptr, *adj;
+    buildSymmetricPattern(A, &ptr, &adj);
+
+    int *degree = (int *)allocateOrExit(n * sizeof(int), "the degrees");
+    int max_degree = 0;
+    for (int i = 0; i < n; i++)
+    {
+        degree[i] = ptr[i + 1] - ptr[i];
+        if (degree[i] > max_degree)
+        {
+            max_degree = degree[i];
+        }
+    }
+
+    int *order = (int *)allocateOrExit(n * sizeof(int), "the ordering");   // Cuthill-McKee order, reversed at the end
+    int *level = (int *)allocateOrExit(n * sizeof(int), "the BFS levels"); // scratch space for the pseudo-peripheral node search
+    char *visited = (char *)calloc(n > 0 ? n : 1, sizeof(char));
+    if (visited == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for visited.\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(level, -1, n * sizeof(int));
+
+    // connected components are started from their lowest degree node, so the nodes are visited by increasing degree
+    int *by_degree = countingSortByKey(degree, n, max_degree);
+
+    int ordered = 0; // number of nodes placed in order so far
+    for (int s = 0; s < n; s++)
+    {
+        int start = by_degree[s];
+        if (visited[start])
+        {
+            continue; // already part of a component that was ordered
+        }
+
+        // the unused tail of order is big enough to serve as the BFS queue of this component
+        int root = pseudoPeripheralNode(ptr, adj, degree, start, level, order + ordered);
+
+        // Cuthill-McKee: breadth first search where the new neighbours of every node are appended by increasing degree
+        int head = ordered;
+        order[ordered++] = root;
+        visited[root] = 1;
+        while (head < ordered)
+        {
+            int node = order[head++];
+            int first_new = ordered;
+            for (int j = ptr[node]; j < ptr[node + 1]; j++)
+            {
+                if (!visited[adj[j]])
+                {
+                    visited[adj[j]] = 1;
+                    order[ordered++] = adj[j];
+                }
+            }
+            sortByDegree(order + first_new, ordered - first_new, degree);
+        }
+    }
+
+    for (int i = 0; i < n / 2; i++) // reversing the Cuthill-McKee order gives the same bandwidth but a smaller profile (less fill)
+    {
+        int temp = order[i];
+        order[i] = order[n - 1 - i];
+        order[n - 1 - i] = temp;
+    }
+
+    free(ptr);
+    free(adj);
+    free(degree);
+    free(level);
+    free(visited);
+    free(by_degree);
+    return order;
+}
+
+int *degreeOrdering(const CSRMatrix *A)
+{
+    int *row_length = (int *)allocateOrExit(A->num_rows * sizeof(int), "the row lengths");
+    int max_length = 0;
+    for (int i = 0; i < A->num_rows; i++)
+    {
+        row_length[i] = A->row_ptr[i + 1] - A->row_ptr[i];
+        if (row_length[i] > max_length)
+        {
+            max_length = row_length[i];
+        }
+    }
+
+    int *order = countingSortByKey(row_length, A->num_rows, max_length);
+    free(row_length);
+    return order;
+}
+
+int *invertPermutation(const int *perm, int n)
+{
+    int *inverse = (int *)allocateOrExit(n * sizeof(int), "the inverse permutation");
+    for (int i = 0; i < n; i++)
+    {
+        inverse[perm[i]] = i;
+    }
+    return inverse;
+}
+
+CSRMatrix permuteMatrix(const CSRMatrix *A, const int *row_perm, const int *col_perm, int num_threads)
+{
+    CSRMatrix C;
+    C.num_rows = A->num_rows;
+    C.num_cols = A->num_cols;
+    C.num_non_zeros = A->num_non_zeros;
+    C.row_ptr = (int *)allocateOrExit((C.num_rows + 1) * sizeof(int), "row_ptr");
+    C.col_ind = (int *)allocateOrExit((size_t)C.num_non_zeros * sizeof(int), "col_ind");
+    C.csr_data = (double *)allocateOrExit((size_t)C.num_non_zeros * sizeof(double), "csr_data");
+
+    // the new row pointers are the prefix sum of the lengths of the rows in their new order
+    C.row_ptr[0] = 0;
+    for (int i = 0; i < C.num_rows; i++)
+    {
+        int source = row_perm != NULL ? row_perm[i] : i;
+        C.row_ptr[i + 1] = C.row_ptr[i] + (A->row_ptr[source + 1] - A->row_ptr[source]);
+    }
+
+    // a column that used to be col_perm[j] becomes column j, so the columns are translated through the inverse permutation
+    int *col_inverse = col_perm != NULL ? invertPermutation(col_perm, A->num_cols) : NULL;
+
+    if (num_threads < 1)
+    {
+        num_threads = 1;
+    }
+
+    // every row of C is copied from exactly one row of A into its own part of the arrays, so the rows can be copied in parallel
+#pragma omp parallel for schedule(dynamic, 256) num_threads(num_threads)
+    for (int i = 0; i < C.num_rows; i++)
+    {
+        int source = row_perm != NULL ? row_perm[i] : i;
+        int dest = C.row_ptr[i];
+        for (int j = A->row_ptr[source]; j < A->row_ptr[source + 1]; j++, dest++)
+        {
+            C.col_ind[dest] = col_inverse != NULL ? col_inverse[A->col_ind[j]] : A->col_ind[j];
+            C.csr_data[dest] = A->csr_data[j];
+        }
+    }
+
+    C.sorted = col_perm == NULL ? A->sorted : 0; // moving whole rows keeps them sorted, renumbering the columns does not
+    C.owns_data = 1;
+    free(col_inverse);
+    return C;
+}
+
+CSRMatrix permuteSymmetric(const CSRMatrix *A, const int *perm, int num_threads)
+{
+    return permuteMatrix(A, perm, perm, num_threads);
+}
+
+CSRMatrix unpermuteSymmetric(const CSRMatrix *A, const int *perm, int num_threads)
+{
+    int *inverse = invertPermutation(perm, A->num_rows); // permuting with the inverse moves every row and column back to where it came from
+    CSRMatrix C = permuteMatrix(A, inverse, inverse, num_threads);
+    free(inverse);
+    return C;
+}
+
+int matrixBandwidth(const CSRMatrix *A)
+{
+    int bandwidth = 0;
+    for (int i = 0; i < A->num_rows; i++)
+    {
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++)
+        {
+            int distance = abs(i - A->col_ind[j]); // distance of the entry from the diagonal
+            if (distance > bandwidth)
+            {
+                bandwidth = distance;
+            }
+        }
+    }
+    return bandwidth;
+}
+
+long long matrixProfile(const CSRMatrix *A)
+{
+    long long profile = 0;
+    for (int i = 0; i < A->num_rows; i++)
+    {
+        int first_col = i; // the envelope of a row starts at its leftmost entry, or at the diagonal if there is nothing to the left of it
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++)
+        {
+            if (A->col_ind[j] < first_col)
+            {
+                first_col = A->col_ind[j];
+            }
+        }
+        profile += i - first_col;
+    }
+    return profile;
+}
@@ -0,0 +1,18 @@
+#ifndef REORDER_H
+#define REORDER_H
+
+#include "functions.h" // needed for the CSRMatrix struct
+
+/* Row/column reordering of CSR matrices. Every permutation in this module is an array perm of length n where
+perm[new_index] = old_index, so row i of the permuted matrix is row perm[i] of the original matrix. */
+
+int *reverseCuthillMcKee(const CSRMatrix *A); // bandwidth reducing ordering of a square matrix, computed on the pattern of A + A^T
+int *degreeOrdering(const CSRMatrix *A);      // orders the rows of A by increasing number of non-zeros (ties keep their original order)
+int *invertPermutation(const int *perm, int n); // returns inverse with inverse[perm[i]] = i
+CSRMatrix permuteMatrix(const CSRMatrix *A, const int *row_perm, const int *col_perm, int num_threads); // returns A(row_perm, col_perm), a NULL permutation leaves that dimension unchanged
+CSRMatrix permuteSymmetric(const CSRMatrix *A, const int *perm, int num_threads);   // returns P A P^T, i.e. the same permutation applied to rows and columns
+CSRMatrix unpermuteSymmetric(const CSRMatrix *A, const int *perm, int num_threads); // undoes permuteSymmetric(): returns P^T A P
+int matrixBandwidth(const CSRMatrix *A); // largest |i - j| over all non-zero entries (i, j)
+long long matrixProfile(const CSRMatrix *A); // sum over the rows of the distance from the first non-zero column to the diagonal (envelope size)
+
+#endif
@@ -0,0 +1,172 @@
+#include <stdio.h>     // the standard c library
+#include "submatrix.h" // reference the header file with the extraction declarations
+#include <stdlib.h>    // provides memory allocation functions
+#include <string.h>    // provides memcpy()
+
+CSRMatrix rowRangeView(const CSRMatrix *A, int first_row, int last_row)
+{
+    if (first_row < 0 || last_row > A->num_rows || first_row > last_row)
+    {
+        fprintf(stderr, "Error: Row range %d to %d is outside of the matrix.\n", first_row + 1, last_row);
+        exit(EXIT_FAILURE);
+    }
+
+    CSRMatrix V;
+    V.num_rows = last_row - first_row;
+    V.num_cols = A->num_cols;
+    V.row_ptr = (int *)malloc((V.num_rows + 1) * sizeof(int));
+    if (V.row_ptr == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for row_ptr.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // the rows are contiguous in col_ind and csr_data, so the view points into them and only the row pointers are rebased to start at 0
+    int base = A->row_ptr[first_row];
+    for (int i = 0; i <= V.num_rows; i++)
+    {
+        V.row_ptr[i] = A->row_ptr[first_row + i] - base;
+    }
+    V.col_ind = A->col_ind + base;
+    V.csr_data = A->csr_data + base;
+    V.num_non_zeros = V.row_ptr[V.num_rows];
+    V.sorted = A->sorted;
+    V.owns_data = 0;
+    return V;
+}
+
+CSRMatrix extractRows(const CSRMatrix *A, const int *rows, int num_rows, int num_threads)
+{
+    return extractSubmatrix(A, rows, num_rows, NULL, 0, num_threads);
+}
+
+CSRMatrix extractSubmatrix(const CSRMatrix *A, const int *rows, int num_rows, const int *cols, int num_cols, int num_threads)
+{
+    if (num_threads < 1)
+    {
+        num_threads = 1;
+    }
+
+    CSRMatrix C;
+    C.num_rows = rows != NULL ? num_rows : A->num_rows;
+    C.num_cols = cols != NULL ? num_cols : A->num_cols;
+    if (rows != NULL)
+    {
+        for (int i = 0; i < num_rows; i++)
+        {
+            if (rows[i] < 0 || rows[i] >= A->num_rows)
+            {
+                fprintf(stderr, "Error: Row %d is outside of the matrix.\n", rows[i] + 1);
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+
+    /* Column selection goes through a lookup table with one entry per column of A: the new column number of a selected column,
+    -1 for the others. Testing an entry is then a single load, no matter how many columns are selected. */
+    int *column_map = NULL;
+    int keeps_order = 1; // the selected columns are in increasing order, so sorted rows stay sorted
+    if (cols != NULL)
+    {
+        column_map = (int *)malloc((A->num_cols > 0 ? A->num_cols : 1) * sizeof(int));
+        if (column_map == NULL)
+        {
+            fprintf(stderr, "Error: Memory allocation failed for the column map.\n");
+            exit(EXIT_FAILURE);
+        }
+        memset(column_map, -1, (size_t)A->num_cols * sizeof(int));
+        for (int k = 0; k < num_cols; k++)
+        {
+            if (cols[k] < 0 || cols[k] >= A->num_cols || column_map[cols[k]] != -1)
+            {
+                fprintf(stderr, "Error: Column %d is outside of the matrix or selected twice.\n", cols[k] + 1);
+                exit(EXIT_FAILURE);
+            }
+            column_map[cols[k]] = k;
+            if (k > 0 && cols[k] < cols[k - 1])
+            {
+                keeps_order = 0;
+            }
+        }
+    }
+
+    C.row_ptr = (int *)malloc((C.num_rows + 1) * sizeof(int));
+    if (C.row_ptr == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for row_ptr.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // first pass: count the entries every row of C keeps, the rows are independent so they are counted in parallel
+#pragma omp parallel for schedule(dynamic, 256) num_threads(num_threads)
+    for (int i = 0; i < C.num_rows; i++)
+    {
+        int source = rows != NULL ? rows[i] : i;
+        int count = 0;
+        if (column_map == NULL)
+        {
+            count = A->row_ptr[source + 1] - A->row_ptr[source];
+        }
+        else
+        {
+            for (int j = A->row_ptr[source]; j < A->row_ptr[source + 1]; j++)
+            {
+                count += column_map[A->col_ind[j]] >= 0;
+            }
+        }
+        C.row_ptr[i + 1] = count;
+    }
+
+    long long total = 0; // a repeated row list can ask for more entries than A has
+    C.row_ptr[0] = 0;
+    for (int i = 0; i < C.num_rows; i++)
+    {
+        total += C.row_ptr[i + 1];
+        if (total > 2147483647LL)
+        {
+            fprintf(stderr, "Error: The submatrix has more non-zeros than a CSR matrix can hold.\n");
+            exit(EXIT_FAILURE);
+        }
+        C.row_ptr[i + 1] = (int)total;
+    }
+    C.num_non_zeros = (int)total;
+    C.col_ind = (int *)malloc((total > 0 ? total : 1) * sizeof(int));
+    C.csr_data = (double *)malloc((total > 0 ? total : 1) * sizeof(double));
+    if (C.col_ind == NULL || C.csr_data == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for the submatrix.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // second pass: every row knows where it starts, so the rows are copied in parallel without any synchronization
+#pragma omp parallel for schedule(dynamic, 256) num_threads(num_threads)
+    for (int i = 0; i < C.num_rows; i++)
+    {
+        int source = rows != NULL ? rows[i] : i;
+        int write = C.row_ptr[i];
+        if (column_map == NULL)
+        {
+            int length = A->row_ptr[source + 1] - A->row_ptr[source];
+            memcpy(C.col_ind + write, A->col_ind + A->row_ptr[source], length * sizeof(int));
+            memcpy(C.csr_data + write, A->csr_data + A->row_ptr[source], length * sizeof(double));
+        }
+        else
+        {
+            for (int j = A->row_ptr[source]; j < A->row_ptr[source + 1]; j++)
+            {
+                int col = column_map[A->col_ind[j]];
+                if (col >= 0)
+                {
+                    C.col_ind[write] = col;
+                    C.csr_data[write] = A->csr_data[j];
+                    write++;
+                }
+            }
+        }
+    }
+
+    C.sorted = A->sorted && keeps_order;
+    C.owns_data = 1;
+    free(column_map);
+    return C;
+}
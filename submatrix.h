@@ -0,0 +1,13 @@
+#ifndef SUBMATRIX_H
+#define SUBMATRIX_H
+
+#include "functions.h" // needed for the CSRMatrix struct
+
+/* Row ranges are zero-copy views: they get their own row_ptr but share col_ind and csr_data with the parent (owns_data = 0),
+so freeMatrix() on the view leaves the parent intact and the parent must outlive the view. Sorting a view sorts those rows
+of the parent as well. Everything else builds a matrix with its own arrays. */
+CSRMatrix rowRangeView(const CSRMatrix *A, int first_row, int last_row); // view of rows first_row .. last_row - 1
+CSRMatrix extractRows(const CSRMatrix *A, const int *rows, int num_rows, int num_threads); // A(rows, :) for any list of rows, repeats allowed
+CSRMatrix extractSubmatrix(const CSRMatrix *A, const int *rows, int num_rows, const int *cols, int num_cols, int num_threads); // A(rows, cols), NULL rows or cols selects all of them
+
+#endif
@@ -0,0 +1,334 @@
+#include <stdio.h>     // the standard c library
+#include "trisolve.h"  // reference the header file with the triangular solve declarations
+#include <stdlib.h>    // provides memory allocation functions
+#include <string.h>    // provides memcpy()
+#include <sched.h>     // provides sched_yield() for threads waiting on another row
+#ifdef _OPENMP
+#include <omp.h>       // provides omp_get_thread_num() when the program is compiled with OpenMP
+#endif
+
+#define SMALL_LEVEL 64       // levels with fewer rows than this are not worth sharing out, runs of them are solved by one thread
+#define SPINS_BEFORE_YIELD 1024 // a waiting row gives its core away after this many checks, in case the thread it waits for shares it
+
+// 1 when column col of row i is part of the triangle that is solved (the diagonal is handled separately)
+static int inTriangle(int lower, int i, int col)
+{
+    return lower ? col < i : col > i;
+}
+
+// Stops the program when row i has no usable diagonal entry
+static void missingDiagonal(int i)
+{
+    fprintf(stderr, "Error: Row %d has no non-zero diagonal entry, use a unit diagonal or fix the matrix.\n", i + 1);
+    exit(EXIT_FAILURE);
+}
+
+void triangularMultiply(const CSRMatrix *A, int lower, int unit_diagonal, const double *x, double *y)
+{
+    for (int i = 0; i < A->num_rows; i++)
+    {
+        double sum = unit_diagonal ? x[i] : 0.0;
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++)
+        {
+            int col = A->col_ind[j];
+            if (inTriangle(lower, i, col) || (!unit_diagonal && col == i))
+            {
+                sum += A->csr_data[j] * x[col];
+            }
+        }
+        y[i] = sum;
+    }
+}
+
+void solveTriangularSerial(const CSRMatrix *A, int lower, int unit_diagonal, const double *b, double *x)
+{
+    if (A->num_rows != A->num_cols)
+    {
+        fprintf(stderr, "Error: Triangular solves need a square matrix.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // forward substitution goes down the rows, back substitution goes up, each row only needs entries of x that are already known
+    for (int step = 0; step < A->num_rows; step++)
+    {
+        int i = lower ? step : A->num_rows - 1 - step;
+        double sum = b[i];
+        double diagonal = 0.0;
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++)
+        {
+            int col = A->col_ind[j];
+            if (inTriangle(lower, i, col))
+            {
+                sum -= A->csr_data[j] * x[col];
+            }
+            else if (col == i)
+            {
+                diagonal += A->csr_data[j];
+            }
+        }
+        if (!unit_diagonal && diagonal == 0.0)
+        {
+            missingDiagonal(i);
+        }
+        x[i] = unit_diagonal ? sum : sum / diagonal;
+    }
+}
+
+void solveTriangularColumns(const CSRMatrix *A_transpose, int lower, int unit_diagonal, const double *b, double *x)
+{
+    int n = A_transpose->num_rows;
+    memcpy(x, b, n * sizeof(double));
+
+    /* Row j of A^T is column j of A. As soon as x[j] is final, its contribution is subtracted from every later row at once,
+    which reads A column by column without searching the rows of A. */
+    for (int step = 0; step < n; step++)
+    {
+        int j = lower ? step : n - 1 - step;
+        if (!unit_diagonal)
+        {
+            double diagonal = 0.0;
+            for (int k = A_transpose->row_ptr[j]; k < A_transpose->row_ptr[j + 1]; k++)
+            {
+                if (A_transpose->col_ind[k] == j)
+                {
+                    diagonal += A_transpose->csr_data[k];
+                }
+            }
+            if (diagonal == 0.0)
+            {
+                missingDiagonal(j);
+            }
+            x[j] /= diagonal;
+        }
+        for (int k = A_transpose->row_ptr[j]; k < A_transpose->row_ptr[j + 1]; k++)
+        {
+            int i = A_transpose->col_ind[k]; // row of A that entry (i, j) belongs to
+            if (inTriangle(lower, i, j))
+            {
+                x[i] -= A_transpose->csr_data[k] * x[j];
+            }
+        }
+    }
+}
+
+void analyseTriangular(const CSRMatrix *A, int lower, int unit_diagonal, TriangularPlan *plan)
+{
+    if (A->num_rows != A->num_cols)
+    {
+        fprintf(stderr, "Error: Triangular solves need a square matrix.\n");
+        exit(EXIT_FAILURE);
+    }
+    int n = A->num_rows;
+    plan->lower = lower;
+    plan->unit_diagonal = unit_diagonal;
+    plan->num_rows = n;
+    plan->diagonal = NULL;
+
+    int *level = (int *)malloc((n > 0 ? n : 1) * sizeof(int));
+    plan->order = (int *)malloc((n > 0 ? n : 1) * sizeof(int));
+    if (level == NULL || plan->order == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for the triangular solve analysis.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (!unit_diagonal)
+    {
+        plan->diagonal = (double *)malloc((n > 0 ? n : 1) * sizeof(double));
+        if (plan->diagonal == NULL)
+        {
+            fprintf(stderr, "Error: Memory allocation failed for the triangular solve analysis.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    /* The level of a row is one more than the highest level of the rows it needs, rows without dependencies are level 0.
+    Rows of the same level never depend on each other, so a level can be solved in parallel once the earlier levels are done.
+    Visiting the rows in substitution order means the levels of the needed rows are always known already. */
+    plan->num_levels = 0;
+    for (int step = 0; step < n; step++)
+    {
+        int i = lower ? step : n - 1 - step;
+        int row_level = 0;
+        double diagonal = 0.0;
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++)
+        {
+            int col = A->col_ind[j];
+            if (inTriangle(lower, i, col))
+            {
+                if (level[col] + 1 > row_level)
+                {
+                    row_level = level[col] + 1;
+                }
+            }
+            else if (col == i)
+            {
+                diagonal += A->csr_data[j]; // duplicates are added up, the same as the serial solves do
+            }
+        }
+        if (!unit_diagonal)
+        {
+            if (diagonal == 0.0)
+            {
+                missingDiagonal(i);
+            }
+            plan->diagonal[i] = diagonal;
+        }
+        level[i] = row_level;
+        if (row_level + 1 > plan->num_levels)
+        {
+            plan->num_levels = row_level + 1;
+        }
+    }
+
+    // counting sort of the rows by level, the rows of a level stay in increasing order
+    plan->level_ptr = (int *)calloc(plan->num_levels + 1, sizeof(int));
+    if (plan->level_ptr == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for the triangular solve analysis.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < n; i++)
+    {
+        plan->level_ptr[level[i] + 1]++;
+    }
+    for (int l = 0; l < plan->num_levels; l++)
+    {
+        plan->level_ptr[l + 1] += plan->level_ptr[l];
+    }
+    int *next = (int *)malloc((plan->num_levels > 0 ? plan->num_levels : 1) * sizeof(int));
+    if (next == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for the triangular solve analysis.\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(next, plan->level_ptr, plan->num_levels * sizeof(int));
+    for (int i = 0; i < n; i++)
+    {
+        plan->order[next[level[i]]++] = i;
+    }
+
+    free(next);
+    free(level);
+}
+
+// Solves row i once every row it depends on is final
+static void solveRow(const CSRMatrix *A, const TriangularPlan *plan, int i, const double *b, double *x)
+{
+    double sum = b[i];
+    for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++)
+    {
+        if (inTriangle(plan->lower, i, A->col_ind[j]))
+        {
+            sum -= A->csr_data[j] * x[A->col_ind[j]];
+        }
+    }
+    x[i] = plan->unit_diagonal ? sum : sum / plan->diagonal[i];
+}
+
+void solveTriangularLevels(const CSRMatrix *A, const TriangularPlan *plan, const double *b, double *x, int num_threads)
+{
+    if (num_threads < 1)
+    {
+        num_threads = 1;
+    }
+
+    /* Every thread walks through the same sequence of levels. A level with enough rows is shared out with an omp for, whose
+    implicit barrier makes its results visible to the next level. A run of small levels is solved by a single thread in
+    substitution order, so the whole run costs one barrier instead of one per level. */
+#pragma omp parallel num_threads(num_threads)
+    {
+        int l = 0;
+        while (l < plan->num_levels)
+        {
+            if (plan->level_ptr[l + 1] - plan->level_ptr[l] >= SMALL_LEVEL)
+            {
+#pragma omp for schedule(static)
+                for (int k = plan->level_ptr[l]; k < plan->level_ptr[l + 1]; k++)
+                {
+                    solveRow(A, plan, plan->order[k], b, x);
+                }
+                l++;
+            }
+            else
+            {
+                int run_end = l;
+                while (run_end < plan->num_levels && plan->level_ptr[run_end + 1] - plan->level_ptr[run_end] < SMALL_LEVEL)
+                {
+                    run_end++;
+                }
+#pragma omp single
+                for (int k = plan->level_ptr[l]; k < plan->level_ptr[run_end]; k++)
+                {
+                    solveRow(A, plan, plan->order[k], b, x);
+                }
+                l = run_end;
+            }
+        }
+    }
+}
+
+void solveTriangularSyncFree(const CSRMatrix *A, const TriangularPlan *plan, const double *b, double *x, int num_threads)
+{
+    if (num_threads < 1)
+    {
+        num_threads = 1;
+    }
+    int n = plan->num_rows;
+    int *done = (int *)calloc(n > 0 ? n : 1, sizeof(int)); // done[i] is set once x[i] is final
+    if (done == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for the triangular solve.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* No barriers at all: the rows are dealt out round robin in level order and a row only waits for the rows it reads. This
+    can not deadlock, because the unfinished row with the lowest level has all its inputs and its thread is either working on it
+    or on another row of the same level, which has all its inputs too. */
+#pragma omp parallel num_threads(num_threads)
+    {
+#ifdef _OPENMP
+        int thread = omp_get_thread_num(), threads = omp_get_num_threads();
+#else
+        int thread = 0, threads = 1;
+#endif
+        for (int k = thread; k < n; k += threads)
+        {
+            int i = plan->order[k];
+            double sum = b[i];
+            for (int j = A->row_ptr[i]; j < A->row_ptr[i + 1]; j++)
+            {
+                int col = A->col_ind[j];
+                if (inTriangle(plan->lower, i, col))
+                {
+                    int ready, spins = 0;
+                    do
+                    {
+#pragma omp atomic read seq_cst
+                        ready = done[col];
+                        if (!ready && ++spins % SPINS_BEFORE_YIELD == 0)
+                        {
+                            sched_yield();
+                        }
+                    } while (!ready);
+                    sum -= A->csr_data[j] * x[col];
+                }
+            }
+            x[i] = plan->unit_diagonal ? sum : sum / plan->diagonal[i];
+#pragma omp atomic write seq_cst
+            done[i] = 1;
+        }
+    }
+
+    free(done);
+}
+
+void freeTriangularPlan(TriangularPlan *plan)
+{
+    free(plan->level_ptr);
+    free(plan->order);
+    free(plan->diagonal);
+    plan->level_ptr = NULL;
+    plan->order = NULL;
+    plan->diagonal = NULL;
+    plan->num_levels = 0;
+}
@@ -0,0 +1,29 @@
+#ifndef TRISOLVE_H
+#define TRISOLVE_H
+
+#include "functions.h" // needed for the CSRMatrix struct
+
+/* Triangular solves T x = b where T is the lower (or upper) triangle of a CSR matrix. Entries on the other side of the diagonal
+are ignored, so the factors can be passed either on their own or stored together in one matrix. With a unit diagonal the
+diagonal entries are not read at all, otherwise every row needs a non-zero diagonal entry. */
+
+// Result of the analysis phase, everything the parallel solves need besides the matrix itself
+typedef struct {
+    int lower;          // 1 for the lower triangle, 0 for the upper triangle
+    int unit_diagonal;  // 1 when the diagonal is taken to be 1
+    int num_rows;       // number of rows of the matrix
+    int num_levels;     // number of level sets
+    int *level_ptr;     // rows of level l are order[level_ptr[l]] .. order[level_ptr[l + 1] - 1]
+    int *order;         // rows sorted by level, every row only depends on rows of earlier levels
+    double *diagonal;   // sum of the diagonal entries of every row, NULL with a unit diagonal
+} TriangularPlan;
+
+void triangularMultiply(const CSRMatrix *A, int lower, int unit_diagonal, const double *x, double *y); // y = T x, used to make right hand sides and check solutions
+void solveTriangularSerial(const CSRMatrix *A, int lower, int unit_diagonal, const double *b, double *x); // row oriented substitution
+void solveTriangularColumns(const CSRMatrix *A_transpose, int lower, int unit_diagonal, const double *b, double *x); // column oriented substitution on transpose(A)
+void analyseTriangular(const CSRMatrix *A, int lower, int unit_diagonal, TriangularPlan *plan); // builds the level sets
+void solveTriangularLevels(const CSRMatrix *A, const TriangularPlan *plan, const double *b, double *x, int num_threads); // one level at a time with a barrier between levels
+void solveTriangularSyncFree(const CSRMatrix *A, const TriangularPlan *plan, const double *b, double *x, int num_threads); // no barriers, rows wait only for the rows they need
+void freeTriangularPlan(TriangularPlan *plan); // frees the arrays of the plan
+
+#endif